@@ -0,0 +1,343 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/Composition.h>
+#include <safl/Future.h>
+#include <safl/LoopExecutor.h>
+#include <safl/ThreadPoolExecutor.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace safl;
+
+namespace {
+
+std::atomic<std::size_t> g_cntAllocations{0};
+
+} // anonymous namespace
+
+/* Count allocations of the whole process, in order to report them per stage.
+ * These are not inlined, so the compiler does not pair malloc() with delete. */
+[[ gnu::noinline ]]
+void *operator new(std::size_t size)
+{
+    g_cntAllocations.fetch_add(1, std::memory_order_relaxed);
+    if ( void *ptr = std::malloc(size == 0 ? 1 : size) ) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[ gnu::noinline ]]
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+[[ gnu::noinline ]]
+void operator delete(void *ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+
+class LoopScope
+{
+public:
+    LoopScope() noexcept
+    {
+        Executor::setThreadInstance(&m_loop);
+    }
+
+    ~LoopScope()
+    {
+        Executor::setThreadInstance(nullptr);
+    }
+
+    LoopExecutor &loop() noexcept
+    {
+        return m_loop;
+    }
+
+private:
+    LoopExecutor m_loop;
+};
+
+/* Fulfil a chain of trivial synchronous continuations and wait for its end,
+ * the same way as CoreTests do. */
+void chainLatency(benchmark::State &state, ContinuationPolicy policy)
+{
+    LoopScope scope;
+    const auto cntStages = static_cast<std::size_t>(state.range(0));
+
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        Promise<int> p;
+        std::vector<Future<int>> chain;
+        chain.reserve(cntStages + 1);
+        chain.push_back(p.future());
+        for ( std::size_t i = 0; i < cntStages; i++ ) {
+            chain.push_back(chain.back().then(policy, [](int value)
+            {
+                return value + 1;
+            }));
+        }
+
+        state.ResumeTiming();
+
+        p.setValue(0);
+        scope.loop().runUntilIdle();
+        benchmark::DoNotOptimize(chain.back().value());
+
+        state.PauseTiming();
+        chain.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/* The same in a thread pool, where the chain is fulfilled from outside and
+ * each posted continuation goes through a worker queue. */
+void poolChainLatency(benchmark::State &state, ContinuationPolicy policy)
+{
+    ThreadPoolExecutor pool(2);
+    const auto cntStages = static_cast<std::size_t>(state.range(0));
+
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        Promise<int> p;
+        std::atomic<bool> isDone{false};
+        std::vector<Future<int>> chain;
+        chain.reserve(cntStages + 1);
+        chain.push_back(p.future().via(pool));
+        for ( std::size_t i = 0; i < cntStages; i++ ) {
+            chain.push_back(chain.back().then(policy, [](int value)
+            {
+                return value + 1;
+            }));
+        }
+        auto tail = chain.back().then([&](int)
+        {
+            isDone.store(true, std::memory_order_release);
+        });
+        state.ResumeTiming();
+
+        p.setValue(0);
+        while ( !isDone.load(std::memory_order_acquire) ) {
+        }
+
+        state.PauseTiming();
+        chain.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/* Create and destroy chains, which exercises the context allocator. */
+void buildChain(benchmark::State &state)
+{
+    LoopScope scope;
+    const auto cntStages = static_cast<std::size_t>(state.range(0));
+    std::vector<Future<int>> chain;
+    chain.reserve(cntStages + 1);
+
+    for ( auto _ : state ) {
+        Promise<int> p;
+        chain.push_back(p.future());
+        for ( std::size_t i = 0; i < cntStages; i++ ) {
+            chain.push_back(chain.back().then([](int value)
+            {
+                return value + 1;
+            }));
+        }
+        chain.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/* Count global allocations made by then() for chains of separate stages,
+ * after the context pool has been warmed up by the first iterations. */
+void thenAllocations(benchmark::State &state)
+{
+    LoopScope scope;
+    const auto cntStages = static_cast<std::size_t>(state.range(0));
+    std::vector<Future<int>> chain;
+    chain.reserve(cntStages + 1);
+
+    std::size_t cntAllocations = 0;
+    for ( auto _ : state ) {
+        Promise<int> p;
+        chain.push_back(p.future());
+        const std::size_t cntBefore = g_cntAllocations.load(std::memory_order_relaxed);
+        for ( std::size_t i = 0; i < cntStages; i++ ) {
+            chain.push_back(chain.back().then([](int value)
+            {
+                return value + 1;
+            }));
+        }
+        cntAllocations += g_cntAllocations.load(std::memory_order_relaxed) - cntBefore;
+        chain.clear();
+    }
+    state.counters["allocsPerThen"] = static_cast<double>(cntAllocations) /
+            static_cast<double>(state.iterations() * cntStages);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+int addOne(int value)
+{
+    return value + 1;
+}
+
+/* Build and fulfil a pipeline of four synchronous stages, which are fused into
+ * a single continuation. */
+void fusedPipeline(benchmark::State &state)
+{
+    LoopScope scope;
+
+    for ( auto _ : state ) {
+        Promise<int> p;
+        auto f = p.future().then(addOne).then(addOne).then(addOne).then(addOne);
+        p.setValue(0);
+        scope.loop().runUntilIdle();
+        benchmark::DoNotOptimize(f.value());
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+
+/* The same pipeline, whose stages are kept apart by naming their futures. */
+void unfusedPipeline(benchmark::State &state)
+{
+    LoopScope scope;
+
+    for ( auto _ : state ) {
+        Promise<int> p;
+        auto f1 = p.future().then(addOne);
+        auto f2 = f1.then(addOne);
+        auto f3 = f2.then(addOne);
+        auto f = f3.then(addOne);
+        p.setValue(0);
+        scope.loop().runUntilIdle();
+        benchmark::DoNotOptimize(f.value());
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+
+/* Collect futures which are fulfilled in order, e.g. by shard queries. */
+void collectScaling(benchmark::State &state)
+{
+    LoopScope scope;
+    const auto cntInputs = static_cast<std::size_t>(state.range(0));
+
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        std::vector<Promise<int>> promises(cntInputs);
+        std::vector<Future<int>> futures;
+        futures.reserve(cntInputs);
+        for ( auto &p : promises ) {
+            futures.push_back(p.future());
+        }
+        state.ResumeTiming();
+
+        auto f = collect(futures);
+        for ( std::size_t i = 0; i < cntInputs; i++ ) {
+            promises[i].setValue(static_cast<int>(i));
+        }
+        scope.loop().runUntilIdle();
+        benchmark::DoNotOptimize(f.value().data());
+
+        state.PauseTiming();
+        promises.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/* A piece of work of an input, long enough to outweigh its scheduling. */
+int crunch(int value)
+{
+    for ( int i = 0; i < 1000; i++ ) {
+        value = value * 31 + i;
+        benchmark::DoNotOptimize(value);
+    }
+    return value;
+}
+
+/* Collect inputs which are processed in a thread pool, where the throughput
+ * should grow with the number of workers. */
+void poolCollectScaling(benchmark::State &state)
+{
+    ThreadPoolExecutor pool(static_cast<std::size_t>(state.range(0)));
+    const auto cntInputs = static_cast<std::size_t>(state.range(1));
+    /* The contexts created here, including that of collect(), run in the pool. */
+    Executor::setThreadInstance(&pool);
+
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        std::vector<Promise<int>> promises(cntInputs);
+        std::vector<Future<int>> futures;
+        futures.reserve(cntInputs);
+        for ( auto &p : promises ) {
+            futures.push_back(p.future().then(crunch));
+        }
+        std::atomic<bool> isDone{false};
+        auto all = collect(futures).then([&](const std::vector<int> &values)
+        {
+            benchmark::DoNotOptimize(values.data());
+            isDone.store(true, std::memory_order_release);
+        });
+        state.ResumeTiming();
+
+        for ( std::size_t i = 0; i < cntInputs; i++ ) {
+            promises[i].setValue(static_cast<int>(i));
+        }
+        while ( !isDone.load(std::memory_order_acquire) ) {
+        }
+
+        state.PauseTiming();
+        promises.clear();
+        state.ResumeTiming();
+    }
+    Executor::setThreadInstance(nullptr);
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+void postedChain(benchmark::State &state)
+{
+    chainLatency(state, ContinuationPolicy::Post);
+}
+
+void inlineChain(benchmark::State &state)
+{
+    chainLatency(state, ContinuationPolicy::Inline);
+}
+
+void postedPoolChain(benchmark::State &state)
+{
+    poolChainLatency(state, ContinuationPolicy::Post);
+}
+
+void inlinePoolChain(benchmark::State &state)
+{
+    poolChainLatency(state, ContinuationPolicy::Inline);
+}
+
+} // anonymous namespace
+
+BENCHMARK(buildChain)->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK(thenAllocations)->Arg(1)->Arg(100);
+BENCHMARK(fusedPipeline);
+BENCHMARK(unfusedPipeline);
+BENCHMARK(collectScaling)->Arg(10)->Arg(1000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(poolCollectScaling)->Args({1, 1000})->Args({2, 1000})->Args({4, 1000})->Args({8, 1000})
+        ->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(postedChain)->Arg(1)->Arg(3)->Arg(10)->Arg(100);
+BENCHMARK(inlineChain)->Arg(1)->Arg(3)->Arg(10)->Arg(100);
+BENCHMARK(postedPoolChain)->Arg(1)->Arg(3)->Arg(10)->Arg(100)->UseRealTime();
+BENCHMARK(inlinePoolChain)->Arg(1)->Arg(3)->Arg(10)->Arg(100)->UseRealTime();
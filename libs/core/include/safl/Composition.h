@@ -6,35 +6,139 @@
 
 #include "Future.h"
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
 #include <vector>
-#include <map>
 
 namespace safl {
 
 namespace detail {
 
-template<typename tPrevContext, typename tInput>
-class CollectContainer
-        : public std::map<tPrevContext, tInput>
+/* The slots of collected values. Values which can be default constructed are
+ * written straight into the result, except for bools, which are packed. */
+template<typename tInput, bool = std::is_default_constructible<tInput>::value &&
+                                 !std::is_same<tInput, bool>::value>
+class CollectSlots
 {
+public:
+    explicit CollectSlots(std::size_t size)
+        : m_values(size)
+    {
+    }
+
+    void set(std::size_t index, tInput &&value) noexcept
+    {
+        m_values[index] = std::move(value);
+    }
+
+    std::vector<tInput> take() noexcept
+    {
+        return std::move(m_values);
+    }
+
+private:
+    std::vector<tInput> m_values;
 };
 
-template<typename tPrevContext>
-class CollectContainer<tPrevContext, void>
-        : public std::set<tPrevContext>
+/* Other values are constructed in raw slots, and moved into the result once
+ * all of them are there. */
+template<typename tInput>
+class CollectSlots<tInput, false>
 {
+public:
+    explicit CollectSlots(std::size_t size)
+        : m_size(size)
+        , m_slots(new Slot[size])
+        , m_isSet(new bool[size]())
+    {
+    }
+
+    ~CollectSlots()
+    {
+        for ( std::size_t i = 0; i < m_size; i++ ) {
+            if ( m_isSet[i] ) {
+                slot(i).~tInput();
+            }
+        }
+    }
+
+    void set(std::size_t index, tInput &&value) noexcept
+    {
+        new (&m_slots[index]) tInput(std::move(value));
+        m_isSet[index] = true;
+    }
+
+    std::vector<tInput> take() noexcept
+    {
+        std::vector<tInput> values;
+        values.reserve(m_size);
+        for ( std::size_t i = 0; i < m_size; i++ ) {
+            values.push_back(std::move(slot(i)));
+        }
+        return values;
+    }
+
+private:
+    using Slot = std::aligned_storage_t<sizeof(tInput), alignof(tInput)>;
+
+    tInput &slot(std::size_t index) noexcept
+    {
+        return *reinterpret_cast<tInput*>(&m_slots[index]);
+    }
+
+private:
+    const std::size_t m_size;
+    std::unique_ptr<Slot[]> m_slots;
+    std::unique_ptr<bool[]> m_isSet;
 };
 
 template<typename tInput>
 class CollectContextBase
-        : public ContextBase<std::vector<tInput>>
+        : public FanInContext<std::vector<tInput>>
 {
+protected:
+    explicit CollectContextBase(std::size_t size)
+        : m_slots(size)
+    {
+    }
+
+    void acceptValue(ContextNtBase *ctx) noexcept
+    {
+        /* Inputs have no futures, so their values are moved. */
+        auto *input = static_cast<ContextValueBase<tInput>*>(ctx);
+        m_slots.set(PrevList::indexOf(ctx), std::move(input->mutableValue()));
+    }
+
+    void fulfil() noexcept
+    {
+        this->setValue(m_slots.take());
+    }
+
+private:
+    CollectSlots<tInput> m_slots;
 };
 
 template<>
 class CollectContextBase<void>
-        : public ContextBase<void>
+        : public FanInContext<void>
 {
+protected:
+    explicit CollectContextBase(std::size_t /*size*/)
+    {
+    }
+
+    void acceptValue(ContextNtBase */*ctx*/) noexcept
+    {
+    }
+
+    void fulfil() noexcept
+    {
+        this->setValue();
+    }
 };
 
 template<typename tInput>
@@ -42,23 +146,22 @@ class CollectContext final
         : public CollectContextBase<tInput>
 {
 public:
-    using PrevContextType = ContextValueBase<tInput>;
+    explicit CollectContext(std::size_t expectedSize)
+        : CollectContextBase<tInput>(expectedSize)
+        , m_cntPending(expectedSize)
+    {
+    }
 
-public:
-    CollectContext(std::vector<Future<tInput>> &futures) noexcept
-        : m_expectedSize(futures.size())
+    /* Inputs are attached only after a future for this context exists, because
+     * ready inputs are accepted immediately and would destroy it otherwise. */
+    void attachInputs(std::vector<Future<tInput>> &futures) noexcept
     {
-        DLOG(">> collect: size=" << m_expectedSize);
+        DLOG(">> collect: size=" << futures.size());
 
-        if ( m_expectedSize == 0 ) {
+        if ( futures.empty() ) {
             this->fulfil();
         } else {
-            m_ctxOrder.reserve(m_expectedSize);
-            for ( auto &future : futures ) {
-                auto *ctx = future.takeContext();
-                ctx->setTarget(this, true);
-                m_ctxOrder.push_back(ctx);
-            }
+            this->attachAll(futures);
         }
 
         DLOG("<< collect");
@@ -66,79 +169,302 @@ public:
 
     void acceptInput(ContextNtBase *ctx) noexcept override
     {
-        acceptInput(static_cast<PrevContextType*>(ctx));
+        /* Inputs may be accepted concurrently by different threads of a thread
+         * pool executor. Each of them writes its own slot, and the last one
+         * fulfils the context. */
+        DLOG("@@ collect input: " << ctx->alias());
+        this->acceptValue(ctx);
+
+        if ( m_cntPending.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+            this->fulfil();
+        }
     }
 
-    void acceptInput(PrevContextType *ctx) noexcept
+    void acceptError(ContextNtBase *ctx, Signal &&error) noexcept override
     {
-        DLOG("@@ collect input: " << ctx->alias() << " : " <<
-             m_values.size() + 1 << "/" << m_expectedSize);
+        (void)ctx;
+        DLOG("@@ collect ERROR: " << ctx->alias());
+        /* Report only the first received error. Any further errors from other
+         * observed futures are ignored. The failed input never counts down,
+         * so the context is not fulfilled by the rest. */
+        if ( !m_isFailed.exchange(true, std::memory_order_acq_rel) ) {
+            this->storeError(std::move(error));
+        } else {
+            DLOG("error IGNORED");
+        }
+    }
 
-        this->insertValue(ctx);
+private:
+    std::atomic<std::size_t> m_cntPending;
+    std::atomic<bool> m_isFailed{false};
+};
 
-        if ( this->isReady() ) {
-            /* At lest one collected future reported an error, so this future
-             * is already fulfilled with an error. The rest is ignored. */
-            DLOG("input IGNORED");
+/* The result of an input of collectAny() and collectN(): its index and value. */
+template<typename tInput>
+struct FirstOfItem
+{
+    using Type = std::pair<std::size_t, tInput>;
+
+    static Type make(ContextNtBase *ctx) noexcept
+    {
+        /* Inputs have no futures, so their values are moved. */
+        auto *input = static_cast<ContextValueBase<tInput>*>(ctx);
+        return Type(PrevList::indexOf(ctx), std::move(input->mutableValue()));
+    }
+};
+
+template<>
+struct FirstOfItem<void>
+{
+    using Type = std::size_t;
+
+    static Type make(ContextNtBase *ctx) noexcept
+    {
+        return PrevList::indexOf(ctx);
+    }
+};
+
+/* The context of collectAny() and collectN(), which takes the first results
+ * of its inputs and abandons the rest of them. It fails as soon as there are
+ * not enough inputs left to succeed. */
+template<typename tInput, typename tValue>
+class FirstOfContext final
+        : public FanInContext<tValue>
+{
+public:
+    using Item = typename FirstOfItem<tInput>::Type;
+
+public:
+    FirstOfContext(std::size_t cntNeeded, Signal &&stopMessage) noexcept
+        : m_cntNeeded(cntNeeded)
+        , m_stopMessage(std::move(stopMessage))
+    {
+        m_items.reserve(cntNeeded);
+    }
+
+    /* Inputs are attached only after a future for this context exists. */
+    void attachInputs(std::vector<Future<tInput>> &futures) noexcept
+    {
+        DLOG(">> first of: " << m_cntNeeded << "/" << futures.size());
+
+        m_cntInputs = futures.size();
+        if ( m_cntNeeded > m_cntInputs ) {
+            this->setError(BrokenPromise{});
+        } else if ( m_cntNeeded == 0 ) {
+            fulfil(std::is_same<tValue, Item>{});
+        } else {
+            this->attachAll(futures);
+        }
+
+        DLOG("<< first of");
+    }
+
+    void acceptInput(ContextNtBase *ctx) noexcept override
+    {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        if ( m_isDone ) {
+            DLOG("input IGNORED: " << ctx->alias());
             return;
         }
 
-        if ( m_values.size() == m_expectedSize ) {
-            this->fulfil();
+        m_items.push_back(FirstOfItem<tInput>::make(ctx));
+        if ( m_items.size() == m_cntNeeded ) {
+            m_isDone = true;
+            abandonInputs(ctx);
+            lock.unlock();
+            fulfil(std::is_same<tValue, Item>{});
         }
     }
 
     void acceptError(ContextNtBase *ctx, Signal &&error) noexcept override
     {
-        (void)ctx;
-        DLOG("@@ collect ERROR: " << ctx->alias());
-        /* Report only the first received error. Any further errors from other
-         * observed futures are ignored. */
-        if ( !this->isReady() ) {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        if ( m_isDone ) {
+            DLOG("error IGNORED: " << ctx->alias());
+            return;
+        }
+
+        m_cntFailed++;
+        if ( m_cntFailed > m_cntInputs - m_cntNeeded ) {
+            m_isDone = true;
+            abandonInputs(ctx);
+            lock.unlock();
             this->storeError(std::move(error));
-        } else {
-            DLOG("error IGNORED");
         }
     }
 
 private:
-    template<typename xInput = tInput>
-    std::enable_if_t<std::is_void<xInput>::value>
-    fulfil() noexcept
+    /* The input which decided the result stays attached until it is done,
+     * so this context is not destroyed meanwhile. */
+    void abandonInputs(ContextNtBase *decisive) noexcept
     {
-        this->setValue();
+        for ( auto *prev : this->m_prev ) {
+            if ( prev != nullptr && prev != decisive ) {
+                prev->tryDetachFromTarget(&m_stopMessage);
+            }
+        }
+    }
+
+    void fulfil(std::true_type) noexcept
+    {
+        this->setValue(std::move(m_items.front()));
     }
 
-    template<typename xInput = tInput>
-    std::enable_if_t<!std::is_void<xInput>::value>
-    fulfil() noexcept
+    void fulfil(std::false_type) noexcept
     {
-        std::vector<xInput> result;
-        result.reserve(m_expectedSize);
-        for ( auto *orderedCtx : m_ctxOrder ) {
-            result.push_back(m_values.at(orderedCtx));
+        this->setValue(std::move(m_items));
+    }
+
+private:
+    const std::size_t m_cntNeeded;
+    const Signal m_stopMessage;
+    std::size_t m_cntInputs = 0;
+    std::size_t m_cntFailed = 0;
+    bool m_isDone = false;
+    std::vector<Item> m_items;
+};
+
+template<typename tValue, typename tInput>
+Future<tValue> makeFirstOf(std::vector<Future<tInput>> &futures, std::size_t cntNeeded,
+                           Signal &&stopMessage) noexcept
+{
+    auto *ctx = new FirstOfContext<tInput, tValue>(cntNeeded, std::move(stopMessage));
+    Future<tValue> future(ctx);
+    ctx->attachInputs(futures);
+    return future;
+}
+
+/* The slot of an input of the variadic collect(). Its part of the result is
+ * a tuple, which is empty for void inputs. */
+template<typename tInput>
+class TupleSlot
+{
+public:
+    using Part = std::tuple<tInput>;
+
+public:
+    ~TupleSlot()
+    {
+        if ( m_isSet ) {
+            reinterpret_cast<tInput*>(&m_value)->~tInput();
         }
-        this->setValue(std::move(result));
     }
 
-    template<typename xInput = tInput>
-    std::enable_if_t<std::is_void<xInput>::value>
-    insertValue(PrevContextType *ctx) noexcept
+    void set(ContextNtBase *ctx) noexcept
     {
-        m_values.insert(ctx);
+        /* Inputs have no futures, so their values are moved. */
+        auto *input = static_cast<ContextValueBase<tInput>*>(ctx);
+        new (&m_value) tInput(std::move(input->mutableValue()));
+        m_isSet = true;
     }
 
-    template<typename xInput = tInput>
-    std::enable_if_t<!std::is_void<xInput>::value>
-    insertValue(PrevContextType *ctx) noexcept
+    Part take() noexcept
     {
-        m_values.insert(std::make_pair(ctx, ctx->value()));
+        return Part(std::move(*reinterpret_cast<tInput*>(&m_value)));
     }
 
 private:
-    const std::size_t m_expectedSize;
-    std::vector<PrevContextType*> m_ctxOrder;
-    CollectContainer<PrevContextType*, tInput> m_values;
+    std::aligned_storage_t<sizeof(tInput), alignof(tInput)> m_value;
+    bool m_isSet = false;
+};
+
+template<>
+class TupleSlot<void>
+{
+public:
+    using Part = std::tuple<>;
+
+public:
+    void set(ContextNtBase */*ctx*/) noexcept
+    {
+    }
+
+    Part take() noexcept
+    {
+        return Part();
+    }
+};
+
+template<typename... tInputs>
+using CollectTuple = decltype(std::tuple_cat(std::declval<typename TupleSlot<tInputs>::Part>()...));
+
+/* The context of the variadic collect(). The number of inputs is known at
+ * compile time, so the list of previous contexts uses an array of the context
+ * and the values are kept in typed slots. */
+template<typename... tInputs>
+class TupleCollectContext final
+        : public FanInContext<CollectTuple<tInputs...>>
+{
+public:
+    static constexpr std::size_t c_cntInputs = sizeof...(tInputs);
+
+public:
+    TupleCollectContext() noexcept
+        : m_cntPending(c_cntInputs)
+    {
+    }
+
+    /* Inputs are attached only after a future for this context exists, because
+     * ready inputs are accepted immediately and would destroy it otherwise. */
+    void attachInputs(Future<tInputs> &...futures) noexcept
+    {
+        DLOG(">> collect: size=" << c_cntInputs);
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_prev.lend(m_prevSlots.data(), c_cntInputs);
+        }
+        /* Each input gets the slot of its argument. */
+        (void)std::initializer_list<int>{
+                (futures.takeContext()->setTarget(this, true), 0)...};
+        DLOG("<< collect");
+    }
+
+    void acceptInput(ContextNtBase *ctx) noexcept override
+    {
+        /* Inputs may be accepted concurrently, see CollectContext. */
+        DLOG("@@ collect input: " << ctx->alias());
+        acceptValue(ctx, PrevList::indexOf(ctx), std::index_sequence_for<tInputs...>{});
+
+        if ( m_cntPending.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+            fulfil(std::index_sequence_for<tInputs...>{});
+        }
+    }
+
+    void acceptError(ContextNtBase *ctx, Signal &&error) noexcept override
+    {
+        (void)ctx;
+        DLOG("@@ collect ERROR: " << ctx->alias());
+        if ( !m_isFailed.exchange(true, std::memory_order_acq_rel) ) {
+            this->storeError(std::move(error));
+        }
+    }
+
+private:
+    template<std::size_t tIndex>
+    void acceptValueAt(ContextNtBase *ctx) noexcept
+    {
+        std::get<tIndex>(m_slots).set(ctx);
+    }
+
+    template<std::size_t... tIndices>
+    void acceptValue(ContextNtBase *ctx, std::size_t index,
+                     std::index_sequence<tIndices...>) noexcept
+    {
+        (void)std::initializer_list<int>{
+                (index == tIndices ? (acceptValueAt<tIndices>(ctx), 0) : 0)...};
+    }
+
+    template<std::size_t... tIndices>
+    void fulfil(std::index_sequence<tIndices...>) noexcept
+    {
+        this->setValue(std::tuple_cat(std::get<tIndices>(m_slots).take()...));
+    }
+
+private:
+    std::tuple<TupleSlot<tInputs>...> m_slots;
+    std::array<ContextNtBase*, c_cntInputs> m_prevSlots;
+    std::atomic<std::size_t> m_cntPending;
+    std::atomic<bool> m_isFailed{false};
 };
 
 } // namespace detail
@@ -147,12 +473,96 @@ template<typename tValue>
 auto collect(std::vector<Future<tValue>> &futures) noexcept
     -> Future<std::vector<tValue>>
 {
-    return { new detail::CollectContext<tValue>(futures) };
+    auto *ctx = new detail::CollectContext<tValue>(futures.size());
+    Future<std::vector<tValue>> future(ctx);
+    ctx->attachInputs(futures);
+    return future;
 }
 
 inline Future<void> collect(std::vector<Future<void>> &futures) noexcept
 {
-    return { new detail::CollectContext<void>(futures) };
+    auto *ctx = new detail::CollectContext<void>(futures.size());
+    Future<void> future(ctx);
+    ctx->attachInputs(futures);
+    return future;
+}
+
+/**
+ * @brief Collect the values of futures of different types.
+ *
+ * The result is a tuple of the values in the order of arguments, without
+ * void futures, e.g. @c std::tuple<A, B> for @c Future<A>, @c Future<void>
+ * and @c Future<B>. Only the context of the result is allocated. It fails
+ * with the first error of the futures. The futures are taken over, as by the
+ * other overloads, and left empty.
+ */
+template<typename... tInputs>
+auto collect(Future<tInputs>&... futures) noexcept
+    -> Future<detail::CollectTuple<tInputs...>>
+{
+    static_assert(sizeof...(tInputs) > 0, "Nothing to collect");
+    auto *ctx = new detail::TupleCollectContext<tInputs...>();
+    Future<detail::CollectTuple<tInputs...>> future(ctx);
+    ctx->attachInputs(futures...);
+    return future;
+}
+
+/**
+ * @brief Wait for the first of the futures which succeeds.
+ *
+ * The result is the index of that future and its value, or only the index
+ * for void futures. If all of the futures fail, the result fails with the
+ * last error. As soon as the result is decided, the other futures are
+ * detached, so their contexts are destroyed unless their promises still
+ * exist.
+ */
+template<typename tValue>
+auto collectAny(std::vector<Future<tValue>> &futures) noexcept
+    -> Future<typename detail::FirstOfItem<tValue>::Type>
+{
+    using Item = typename detail::FirstOfItem<tValue>::Type;
+    return detail::makeFirstOf<Item>(futures, 1, detail::Signal());
+}
+
+/**
+ * @brief Wait for the first of the futures which succeeds, and send a message
+ * to the others.
+ *
+ * The message is sent to each future which is detached, so its producer can
+ * stop.
+ */
+template<typename tValue, typename tMessage>
+auto collectAny(std::vector<Future<tValue>> &futures, tMessage &&stopMessage) noexcept
+    -> Future<typename detail::FirstOfItem<tValue>::Type>
+{
+    using Item = typename detail::FirstOfItem<tValue>::Type;
+    return detail::makeFirstOf<Item>(futures, 1,
+                                     detail::makeSignal(std::forward<tMessage>(stopMessage)));
+}
+
+/**
+ * @brief Wait for the first @a cnt futures which succeed.
+ *
+ * The result lists them in the order of completion. It fails as soon as not
+ * enough futures are left to succeed, with the last error. The other futures
+ * are detached as collectAny() does.
+ */
+template<typename tValue>
+auto collectN(std::vector<Future<tValue>> &futures, std::size_t cnt) noexcept
+    -> Future<std::vector<typename detail::FirstOfItem<tValue>::Type>>
+{
+    using Item = typename detail::FirstOfItem<tValue>::Type;
+    return detail::makeFirstOf<std::vector<Item>>(futures, cnt, detail::Signal());
+}
+
+template<typename tValue, typename tMessage>
+auto collectN(std::vector<Future<tValue>> &futures, std::size_t cnt,
+              tMessage &&stopMessage) noexcept
+    -> Future<std::vector<typename detail::FirstOfItem<tValue>::Type>>
+{
+    using Item = typename detail::FirstOfItem<tValue>::Type;
+    return detail::makeFirstOf<std::vector<Item>>(
+            futures, cnt, detail::makeSignal(std::forward<tMessage>(stopMessage)));
 }
 
 } // namespace safl
@@ -0,0 +1,62 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Std includes:
+#include <cstddef>
+#include <vector>
+
+namespace safl {
+
+/**
+ * @brief The allocator of future contexts.
+ *
+ * Contexts are allocated from thread-local slabs, one per size class. Each
+ * slab is a chunk of memory, which is split into blocks of the same size.
+ * A context may be freed by any thread: blocks freed by their own thread go
+ * straight to its free list, others are returned to the owning thread with
+ * a lock-free list and reused after it picks them up.
+ *
+ * Memory of the slabs is never returned to the system. When a thread exits,
+ * its slabs are adopted by the next thread which allocates a context.
+ * Contexts which do not fit into the largest size class are allocated with
+ * the global operator new.
+ */
+class ContextPool
+{
+public:
+    /**
+     * @brief The statistics of a size class, summed over all threads.
+     */
+    struct Stats
+    {
+        std::size_t objectSize;    ///< The maximum size of objects of this class.
+        std::size_t cntLive;       ///< The number of allocated blocks.
+        std::size_t bytesReserved; ///< The size of all slabs of this class.
+    };
+
+public:
+    /**
+     * @brief Reserve blocks for objects of the given size in the calling thread.
+     *
+     * After that, the thread can allocate @a cnt such objects without calling
+     * the global allocator. Sizes of contexts can be obtained from stats()
+     * after a warm-up.
+     */
+    static void reserve(std::size_t objectSize, std::size_t cnt);
+
+    /**
+     * @brief Get the statistics of all size classes.
+     *
+     * Blocks freed by other threads are counted as live until their owning
+     * thread picks them up.
+     */
+    static std::vector<Stats> stats();
+
+    static void *allocate(std::size_t size);
+    static void deallocate(void *ptr, std::size_t size) noexcept;
+};
+
+} // namespace safl
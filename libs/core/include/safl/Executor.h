@@ -5,10 +5,19 @@
 #pragma once
 
 // Local includes:
+#include "detail/Allocation.h"
+#include "detail/TaskNode.h"
 #include "detail/UniqueInstance.h"
 
 // Std includes:
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace safl {
 
@@ -20,21 +29,28 @@ namespace safl {
 namespace detail
 {
 
+class TimerNode;
+
 class InvocableNtBase
-        : private UniqueInstance
+        : public Allocated<false>
+        , private UniqueInstance
 {
 public:
     virtual ~InvocableNtBase() = default;
     virtual void invoke() = 0;
+
+    /* Move-construct a copy of this invocable in the given storage. */
+    virtual InvocableNtBase *moveTo(void *storage) noexcept = 0;
 };
 
 template<typename tFunc>
-class Invocable
+class Invocable final
         : public InvocableNtBase
 {
 public:
-    explicit Invocable(tFunc &&f)
-        : m_f(std::forward<tFunc>(f))
+    template<typename xFunc>
+    explicit Invocable(xFunc &&f)
+        : m_f(std::forward<xFunc>(f))
     {
     }
 
@@ -43,17 +59,60 @@ public:
         m_f();
     }
 
+    InvocableNtBase *moveTo(void *storage) noexcept override
+    {
+        return new (storage) Invocable(std::move(m_f));
+    }
+
 private:
-    std::decay_t<tFunc> m_f;
+    tFunc m_f;
 };
 
+/**
+ * @internal
+ * @brief A move-only type-erased callable.
+ *
+ * Small callables, e.g. lambdas which capture a few pointers, are stored in
+ * place. Others are allocated on the heap.
+ */
 class Task
 {
-public:
+    /* A context, an error handler and an inline signal fit in place, and the
+     * task takes a cache line. */
+    static constexpr std::size_t c_inlineSize = 7 * sizeof(void*);
+    using Storage = std::aligned_storage_t<c_inlineSize>;
+
     template<typename tFunc>
+    using IsInlined = std::integral_constant<bool,
+        sizeof(Invocable<tFunc>) <= sizeof(Storage) &&
+        alignof(Invocable<tFunc>) <= alignof(Storage) &&
+        std::is_nothrow_move_constructible<tFunc>::value>;
+
+public:
+    template<typename tFunc,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<tFunc>, Task>::value>>
     Task(tFunc &&f)
-        : m_f(std::make_unique<Invocable<tFunc>>(std::forward<tFunc>(f)))
+        : m_f(make<std::decay_t<tFunc>>(std::forward<tFunc>(f)))
+    {
+    }
+
+    Task(Task &&other) noexcept
+        : m_f(other.take(&m_storage))
+    {
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if ( this != &other ) {
+            reset();
+            m_f = other.take(&m_storage);
+        }
+        return *this;
+    }
+
+    ~Task()
     {
+        reset();
     }
 
     void invoke()
@@ -61,27 +120,280 @@ public:
         m_f->invoke();
     }
 
+    bool isInline() const noexcept
+    {
+        return m_f == reinterpret_cast<const InvocableNtBase*>(&m_storage);
+    }
+
 private:
-    std::unique_ptr<InvocableNtBase> m_f;
+    template<typename tFunc, typename xFunc>
+    std::enable_if_t<IsInlined<tFunc>::value, InvocableNtBase*>
+    make(xFunc &&f)
+    {
+        /* isInline() relies on the base class being at the same address. */
+        InvocableNtBase *invocable = new (&m_storage) Invocable<tFunc>(std::forward<xFunc>(f));
+        assert(static_cast<void*>(invocable) == &m_storage);
+        return invocable;
+    }
+
+    template<typename tFunc, typename xFunc>
+    std::enable_if_t<!IsInlined<tFunc>::value, InvocableNtBase*>
+    make(xFunc &&f)
+    {
+        return new Invocable<tFunc>(std::forward<xFunc>(f));
+    }
+
+    /* Give the callable away, moving it to the given storage if it is in place. */
+    InvocableNtBase *take(void *storage) noexcept
+    {
+        if ( !isInline() ) {
+            return std::exchange(m_f, nullptr);
+        }
+        InvocableNtBase *f = m_f->moveTo(storage);
+        reset();
+        return f;
+    }
+
+    void reset() noexcept
+    {
+        if ( isInline() ) {
+            m_f->~InvocableNtBase();
+        } else {
+            delete m_f;
+        }
+        m_f = nullptr;
+    }
+
+private:
+    Storage m_storage;
+    InvocableNtBase *m_f;
+};
+
+/**
+ * @internal
+ * @brief A heap-allocated node which runs a task and destroys itself.
+ *
+ * This lets executors with intrusive queues accept plain tasks.
+ */
+class TaskBox final
+        : public TaskNode
+        , public Allocated<false>
+{
+public:
+    explicit TaskBox(Task &&task) noexcept
+        : m_task(std::move(task))
+    {
+    }
+
+    void run() noexcept override
+    {
+        m_task.invoke();
+        delete this;
+    }
+
+private:
+    Task m_task;
 };
 
 } // namespace detail
 
+/**
+ * @brief How continuations are run when their input becomes available.
+ */
+enum class ContinuationPolicy
+{
+    Default, ///< Use the policy of the executor, or the global one.
+    Post,    ///< Always go through the executor queue.
+    Inline   ///< Run in the fulfilling call stack, if it is in the executor thread.
+};
+
 class Executor
         : private detail::UniqueInstance
 {
 public:
     using Task = detail::Task;
+    using TaskNode = detail::TaskNode;
+    using Clock = std::chrono::steady_clock;
 
 public:
     virtual void invoke(Task &&task) noexcept = 0;
 
+    /**
+     * @brief Schedule an intrusive node to be run.
+     *
+     * Executors with intrusive queues link the node directly, so scheduling
+     * does not allocate. The default implementation wraps the node in a task.
+     */
+    virtual void schedule(TaskNode *node) noexcept
+    {
+        invoke([node]()
+        {
+            node->run();
+        });
+    }
+
+    /**
+     * @brief Invoke many tasks at once.
+     *
+     * Executors which pay a lock or a wake-up per task override this to pay
+     * them once per batch. The default implementation invokes the tasks one
+     * by one. The tasks are moved from.
+     */
+    virtual void invokeBatch(Task *tasks, std::size_t cnt) noexcept
+    {
+        for ( std::size_t i = 0; i < cnt; i++ ) {
+            invoke(std::move(tasks[i]));
+        }
+    }
+
+    /**
+     * @brief Schedule a queue of intrusive nodes at once.
+     *
+     * The queue is left empty. The default implementation schedules the nodes
+     * one by one.
+     */
+    virtual void scheduleBatch(detail::TaskQueue &nodes) noexcept
+    {
+        while ( TaskNode *node = nodes.pop() ) {
+            schedule(node);
+        }
+    }
+
+    /**
+     * @brief Check if the calling thread is the one this executor runs tasks in.
+     *
+     * Promises may be fulfilled from any thread, but continuations and error
+     * handlers are always dispatched in the executor thread. The default
+     * implementation is suitable for executors which are used from a single
+     * thread only.
+     */
+    virtual bool isInExecutorThread() const noexcept
+    {
+        return true;
+    }
+
+    /**
+     * @brief Get the current time of this executor.
+     *
+     * Executors with virtual time, e.g. in tests, override this together with
+     * startTimer().
+     */
+    virtual Clock::time_point now() const noexcept
+    {
+        return Clock::now();
+    }
+
+    /**
+     * @brief Schedule a timer node to be expired at its deadline.
+     *
+     * An expired timer is scheduled in its executor. The default
+     * implementation keeps timers in a thread shared by all executors which
+     * do not have timers of their own. Timers which are pending when their
+     * executor is destroyed are dropped.
+     */
+    virtual void startTimer(detail::TimerNode *timer) noexcept;
+
+    /**
+     * @brief Set the continuation policy of this executor.
+     *
+     * ContinuationPolicy::Default makes the executor follow the global policy.
+     */
+    void setContinuationPolicy(ContinuationPolicy policy) noexcept;
+
+    /**
+     * @brief Get the effective continuation policy of this executor.
+     */
+    ContinuationPolicy continuationPolicy() const noexcept;
+
 public:
+    /**
+     * @brief Set the continuation policy of executors which have none.
+     *
+     * The policy is ContinuationPolicy::Post by default.
+     */
+    static void setDefaultContinuationPolicy(ContinuationPolicy policy) noexcept;
+
+    /**
+     * @brief Set how many continuations may be nested in a call stack.
+     *
+     * When a chain of inline continuations reaches this depth, the next one
+     * is posted to the executor, which bounds the stack growth.
+     */
+    static void setMaxInlineDepth(std::size_t depth) noexcept;
+    static std::size_t maxInlineDepth() noexcept;
+
+    /**
+     * @brief Set the process-wide default executor.
+     */
     static void setInstance(Executor *executor) noexcept;
+
+    /**
+     * @brief Set the executor of the calling thread.
+     *
+     * It takes precedence over the default executor in this thread. Passing
+     * @c nullptr makes the thread fall back to the default executor again.
+     */
+    static void setThreadInstance(Executor *executor) noexcept;
+    static Executor *threadInstance() noexcept;
+
+    /**
+     * @brief Get the ambient executor of the calling thread.
+     *
+     * Contexts remember the ambient executor they are created under, and
+     * their continuations and handlers are always dispatched to it.
+     */
     static Executor *instance() noexcept;
 
 protected:
-    ~Executor() noexcept = default;
+    ~Executor() noexcept;
+
+private:
+    std::atomic<ContinuationPolicy> m_policy{ContinuationPolicy::Default};
+};
+
+/**
+ * @brief Fulfil promises in bulk.
+ *
+ * While a scope exists in a thread, futures fulfilled by that thread queue
+ * their continuations in the scope instead of their executors. The scope
+ * passes them to each executor with a single Executor::scheduleBatch() when
+ * it ends, e.g. after a batched response has fulfilled thousands of promises.
+ * Nested scopes join the outermost one. Continuations which run inline are
+ * not affected.
+ */
+class BatchScope
+        : private detail::UniqueInstance
+{
+public:
+    BatchScope() noexcept;
+    ~BatchScope();
+
+    /**
+     * @internal
+     * @brief Queue the node in the scope of the calling thread, if any.
+     *
+     * Returns false if there is no scope, or if it has no room for a batch
+     * of another executor, so the caller schedules the node itself.
+     */
+    static bool defer(Executor *executor, detail::TaskNode *node) noexcept;
+
+private:
+    void flush() noexcept;
+
+private:
+    struct Batch
+    {
+        Executor *executor;
+        detail::TaskQueue nodes;
+    };
+
+    /* A batch usually goes to a handful of executors. Nodes of further ones
+     * are scheduled directly, so deferring never allocates. */
+    static constexpr std::size_t c_maxBatches = 4;
+
+    BatchScope *m_outer;
+    Batch m_batches[c_maxBatches];
+    std::size_t m_cntBatches = 0;
 };
 
 /// @}
@@ -12,7 +12,7 @@ namespace safl {
 /**
  * @brief The Future.
  */
-template<typename tValueType>
+template<typename tValueType, typename... tErrors>
 class Future
         : public detail::FutureNtBase
 {
@@ -23,13 +23,72 @@ public:
 public:
     /**
      * @brief Specify a continuation.
+     *
+     * Consecutive synchronous continuations which are specified on temporary
+     * futures, e.g. @c f.then(a).then(b), run as a single one.
      */
     template<typename tFunc>
-    auto then(tFunc &&f) noexcept
+    auto then(tFunc &&f) & noexcept
+    {
+        return m_ctx->then(std::forward<tFunc>(f));
+    }
+
+    template<typename tFunc>
+    auto then(tFunc &&f) && noexcept
     {
         return m_ctx->then(std::forward<tFunc>(f));
     }
 
+    /**
+     * @brief Specify a continuation which runs in the given executor.
+     *
+     * Continuations and error handlers of the returned @future run in the same
+     * executor, until the chain is moved to another one.
+     */
+    template<typename tFunc>
+    auto then(Executor &executor, tFunc &&f) noexcept
+    {
+        return m_ctx->then(&executor, std::forward<tFunc>(f));
+    }
+
+    /**
+     * @brief Specify a continuation with the given continuation policy.
+     *
+     * The policy overrides the one of the executor for this continuation only.
+     */
+    template<typename tFunc>
+    auto then(ContinuationPolicy policy, tFunc &&f) noexcept
+    {
+        return m_ctx->then(m_ctx->boundExecutor(), std::forward<tFunc>(f), policy);
+    }
+
+    /**
+     * @brief Move the rest of the chain to the given executor.
+     *
+     * The value is moved through a continuation in that executor. It is
+     * copied instead only while this @future still exists, as the value may
+     * be read through it.
+     */
+    auto via(Executor &executor) noexcept
+    {
+        return m_ctx->via(&executor);
+    }
+
+    /**
+     * @brief Fail with Timeout, unless this @future is fulfilled in time.
+     *
+     * The time is measured by the executor of the calling thread. When the
+     * timeout expires, this @future is abandoned, and cancelled unless it is
+     * still referenced.
+     */
+    auto within(Executor::Clock::duration timeout) noexcept -> Future<tValueType>
+    {
+        auto *ctx = new detail::DeadlineContext<tValueType>();
+        Future<tValueType> future(ctx);
+        ctx->attachInput(m_ctx, timeout);
+        return future;
+    }
+
     /**
      * @brief Specify an error handler.
      */
@@ -47,8 +106,33 @@ public:
         return std::move(*static_cast<Future<tValueType>*>(this));
     }
 
+    /**
+     * @brief Specify a handler of the progress of an asynchronous operation.
+     *
+     * The handler gets the progress which the promise of the operation that
+     * currently runs in the chain of this @future reports with
+     * Promise::reportProgress(). It runs in the executor of this @future, once
+     * per run of the executor at most, with the latest progress.
+     */
+    template<typename tFunc>
+    auto &onProgress(tFunc &&f) & noexcept
+    {
+        m_ctx->onProgress(std::forward<tFunc>(f));
+        return *static_cast<Future<tValueType>*>(this);
+    }
+
+    template<typename tFunc>
+    auto onProgress(tFunc &&f) && noexcept
+    {
+        m_ctx->onProgress(std::forward<tFunc>(f));
+        return std::move(*static_cast<Future<tValueType>*>(this));
+    }
+
     /**
      * @brief Send a message to an asynchronous operation.
+     *
+     * The message goes to the operation which currently runs in the chain of
+     * this @future, directly rather than through each continuation.
      */
     template<typename tMessage>
     void sendMessage(tMessage &&msg) noexcept
@@ -56,6 +140,22 @@ public:
         m_ctx->sendMessage(std::forward<tMessage>(msg));
     }
 
+    /**
+     * @brief Tell the asynchronous operations that their result is not needed.
+     *
+     * The inputs of this @future which have no other consumers are detached
+     * up to their promises, which are notified with Promise::onCancel(). This
+     * @future is not fulfilled then, unless its result is on its way already.
+     *
+     * Futures which hold only a result, i.e. of promises and of collect(), are
+     * cancelled when they are dropped. Futures of continuations are not, as
+     * continuations may be run for their side effects.
+     */
+    void cancel() noexcept
+    {
+        m_ctx->cancel();
+    }
+
     /**
      * @brief Check if this @future is ready.
      */
@@ -74,6 +174,19 @@ public:
         return this->m_ctx->value();
     }
 
+    /**
+     * @brief Move the value out of this @future.
+     *
+     * The @future must be ready. After that, value() returns the moved-from
+     * value.
+     */
+    template<typename xValueType = tValueType,
+             typename = std::enable_if_t<!std::is_void<xValueType>::value>>
+    xValueType takeValue() noexcept
+    {
+        return std::move(this->m_ctx->mutableValue());
+    }
+
 public:
     Future(ContextType *ctx)
         : m_ctx(ctx)
@@ -116,27 +229,190 @@ protected:
     ContextType *m_ctx;
 };
 
+/**
+ * @brief A @future whose errors are known at compile time.
+ *
+ * It is fulfilled by Promise<tValueType, tErrors...>, which fails only with
+ * the given errors, or with BrokenPromise. The context keeps the error in a
+ * slot together with the index of its type in the set, so handlers of the set
+ * dispatch on the index at compile time. The @future may be moved to a
+ * Future<tValueType>, which drops the set: its consumers get the error as
+ * usual.
+ */
+template<typename tValueType, typename tError, typename... tErrors>
+class Future<tValueType, tError, tErrors...> final
+        : public Future<tValueType>
+{
+public:
+    using ContextType = detail::ErrorSetContextBase<tValueType, tError, tErrors...>;
+
+public:
+    Future(ContextType *ctx)
+        : Future<tValueType>(ctx)
+    {
+    }
+
+    Future(Future &&other) = default;
+
+    /**
+     * @brief Specify an error handler for the errors it accepts.
+     *
+     * The callable may be overloaded or generic. It must accept at least one
+     * of the errors. The returned @future gets the value, or the result of the
+     * handler, and keeps the errors which the handler does not accept as its
+     * own set. If it accepts all of them, the returned @future is a
+     * Future<tValueType>.
+     */
+    template<typename tFunc>
+    auto onError(tFunc &&f) noexcept
+    {
+        return static_cast<ContextType*>(this->m_ctx)->onErrorOf(std::forward<tFunc>(f));
+    }
+
+    template<typename tFunc>
+    Future &onProgress(tFunc &&f) & noexcept
+    {
+        this->m_ctx->onProgress(std::forward<tFunc>(f));
+        return *this;
+    }
+
+    template<typename tFunc>
+    Future onProgress(tFunc &&f) && noexcept
+    {
+        this->m_ctx->onProgress(std::forward<tFunc>(f));
+        return std::move(*this);
+    }
+};
+
+namespace detail {
+
+/**
+ * @internal
+ * @brief The future of a synchronous continuation.
+ *
+ * A synchronous continuation specified on a temporary FusibleFuture is fused
+ * with the one of this future: a single context runs their composition, and
+ * the context of this future is dropped. Stages are fused only while their
+ * input has not arrived yet, otherwise they run one after another.
+ */
+template<typename tValueType, typename tContext>
+class FusibleFuture final
+        : public Future<tValueType>
+{
+public:
+    FusibleFuture(tContext *ctx)
+        : Future<tValueType>(ctx)
+    {
+    }
+
+    using Future<tValueType>::then;
+
+    template<typename tFunc>
+    auto then(tFunc &&f) && noexcept
+    {
+        using Then = ThenTraits<tValueType, tFunc>;
+        return fuse(std::forward<tFunc>(f), typename Then::DoesFuncReturnFuture{});
+    }
+
+private:
+    template<typename tFunc>
+    auto fuse(tFunc &&f, std::true_type)
+    {
+        /* Asynchronous continuations are never fused. */
+        return this->m_ctx->then(std::forward<tFunc>(f));
+    }
+
+    template<typename tFunc>
+    auto fuse(tFunc &&f, std::false_type)
+    {
+        using Composed = Composition<typename tContext::FunctionType, std::decay_t<tFunc>,
+                                     typename tContext::InputType, tValueType>;
+        using NextValueType = typename ThenTraits<tValueType, tFunc>::ValueType;
+        using Fused = FusedContext<NextValueType, Composed>;
+
+        auto *ctx = static_cast<tContext*>(this->m_ctx);
+        ContextNtBase *input = ctx->canFuse() ? ctx->tryDetachInput() : nullptr;
+
+        InheritedMemoryResource resource(ctx->allocation());
+        Fused *fused = input != nullptr
+                ? new Fused(Composed(std::move(ctx->function()), std::forward<tFunc>(f)))
+                : new Fused(Composed(std::forward<tFunc>(f)));
+        FusibleFuture<NextValueType, Fused> nextFuture(fused);
+
+        if ( input != nullptr ) {
+            ctx->replaceInput(input, fused);
+        } else {
+            fused->bindTo(ctx->boundExecutor());
+            ctx->setTarget(fused);
+        }
+        this->m_ctx->detachFuture();
+        this->m_ctx = nullptr;
+        return nextFuture;
+    }
+};
+
+} // namespace detail
+
 using BrokePromise = detail::BrokenPromise;
+using Timeout = detail::Timeout;
 
 /**
  * @brief The Promise.
+ *
+ * If errors are given, the promise may fail only with them, and its @future
+ * is a Future<tValueType, tErrors...>.
  */
-template<typename tValueType>
+template<typename tValueType, typename... tErrors>
 class Promise final
-        : public detail::PromiseBase<tValueType>
+        : public detail::PromiseBase<tValueType, tErrors...>
 {
 public:
+    Promise() = default;
+
+#if SAFL_HAS_MEMORY_RESOURCE
+    /**
+     * @brief Create a promise whose context graph lives in a memory resource.
+     */
+    explicit Promise(std::pmr::memory_resource *resource) noexcept
+        : detail::PromiseBase<tValueType, tErrors...>(resource)
+    {
+    }
+#endif
+
     void setValue(const tValueType &value) noexcept
     {
         this->m_ctx->setValue(value);
     }
+
+    void setValue(tValueType &&value) noexcept
+    {
+        this->m_ctx->setValue(std::move(value));
+    }
+
+    /**
+     * @brief Construct the value in place from the given arguments.
+     */
+    template<typename... tArgs>
+    void emplaceValue(tArgs &&...args) noexcept
+    {
+        this->m_ctx->emplaceValue(std::forward<tArgs>(args)...);
+    }
 };
 
-template<>
-class Promise<void>
-        : public detail::PromiseBase<void>
+template<typename... tErrors>
+class Promise<void, tErrors...>
+        : public detail::PromiseBase<void, tErrors...>
 {
 public:
+    Promise() = default;
+
+#if SAFL_HAS_MEMORY_RESOURCE
+    explicit Promise(std::pmr::memory_resource *resource) noexcept
+        : detail::PromiseBase<void, tErrors...>(resource)
+    {
+    }
+#endif
+
     void setValue() noexcept
     {
         this->m_ctx->setValue();
@@ -173,4 +449,18 @@ private:
     std::shared_ptr<Promise<tValueType>> m_p;
 };
 
+/**
+ * @brief Get a @future which is fulfilled after the given time.
+ *
+ * The time is measured by the executor of the calling thread. Dropping or
+ * cancelling the @future stops the timer.
+ */
+inline Future<void> sleepFor(Executor::Clock::duration duration) noexcept
+{
+    auto *ctx = new detail::SleepContext();
+    Future<void> future(ctx);
+    ctx->start(duration);
+    return future;
+}
+
 } // namespace safl
@@ -0,0 +1,100 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Local includes:
+#include "Executor.h"
+#include "detail/ConcurrentTaskQueue.h"
+
+// Std includes:
+#include <atomic>
+#include <thread>
+
+namespace safl {
+
+/**
+ * @ingroup Exec
+ * @brief The executor which runs tasks in an event loop driven by the user.
+ *
+ * Tasks are queued in a lock-free multi-producer single-consumer queue, so
+ * invoke() is wait-free and can be called from any thread. The loop is run by
+ * a single thread at a time with one of run(), runOne(), poll() and
+ * runUntilIdle().
+ *
+ * To embed the executor into an existing event loop, e.g. one based on
+ * @c epoll, watch fd() for readability and call poll() when it is readable.
+ *
+ * The executor is available on Linux only, where @c SAFL_HAS_LOOP_EXECUTOR is
+ * defined. Its constructor throws @c std::system_error if the event file
+ * descriptor cannot be created.
+ */
+class LoopExecutor final
+        : public Executor
+{
+public:
+    LoopExecutor();
+    ~LoopExecutor() noexcept;
+
+    void invoke(Task &&task) noexcept override;
+    void schedule(TaskNode *node) noexcept override;
+    bool isInExecutorThread() const noexcept override;
+
+    /**
+     * @brief Run tasks, waiting for new ones, until stop() is called.
+     * @return The number of executed tasks.
+     */
+    std::size_t run() noexcept;
+
+    /**
+     * @brief Wait for a task and run it, unless stop() is called.
+     * @return The number of executed tasks, i.e. 0 or 1.
+     */
+    std::size_t runOne() noexcept;
+
+    /**
+     * @brief Run a bounded batch of ready tasks without waiting.
+     *
+     * If more tasks remain, fd() stays readable, so the embedding loop gets
+     * back to this executor after handling its other events.
+     *
+     * @return The number of executed tasks.
+     */
+    std::size_t poll() noexcept;
+
+    /**
+     * @brief Run ready tasks, including the ones they post, until there are
+     *        none left, without waiting.
+     * @return The number of executed tasks.
+     */
+    std::size_t runUntilIdle() noexcept;
+
+    /**
+     * @brief Make run() or runOne() return as soon as possible.
+     *
+     * This can be called from any thread. The request is consumed by the
+     * function it makes return.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief Get a file descriptor which is readable when there are tasks.
+     */
+    int fd() const noexcept;
+
+private:
+    bool runNext() noexcept;
+    void signal() noexcept;
+    void wait() noexcept;
+    void enterLoop() noexcept;
+
+private:
+    detail::ConcurrentTaskQueue m_queue;
+    std::atomic<bool> m_isSignalled;
+    std::atomic<bool> m_isStopped;
+    std::atomic<std::thread::id> m_threadId;
+    int m_fd;
+};
+
+} // namespace safl
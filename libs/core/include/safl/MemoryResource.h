@@ -0,0 +1,52 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Local includes:
+#include "detail/Allocation.h"
+#include "detail/NonCopyable.h"
+
+#if SAFL_HAS_MEMORY_RESOURCE
+
+namespace safl {
+
+using MemoryResource = std::pmr::memory_resource;
+
+/**
+ * @brief Make the calling thread allocate from a memory resource.
+ *
+ * While the scope exists, promises, contexts of then() and collect(), signals
+ * and tasks created by the thread are allocated from the given resource.
+ * Continuations inherit the resource of their input, so a whole chain lives
+ * in it, even if it is extended later outside of the scope.
+ *
+ * The resource must outlive all objects allocated from it. A resource which
+ * is not thread-safe, e.g. @c std::pmr::monotonic_buffer_resource, must be
+ * used only by chains which are created by a single thread.
+ *
+ * This is available only when safl is compiled as C++17 or later.
+ */
+class MemoryResourceScope final
+        : private detail::NonCopyable
+{
+public:
+    explicit MemoryResourceScope(MemoryResource *resource) noexcept
+        : m_oldResource(detail::currentMemoryResource())
+    {
+        detail::setCurrentMemoryResource(resource);
+    }
+
+    ~MemoryResourceScope()
+    {
+        detail::setCurrentMemoryResource(m_oldResource);
+    }
+
+private:
+    MemoryResource *m_oldResource;
+};
+
+} // namespace safl
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Local includes:
+#include "Executor.h"
+
+// Std includes:
+#include <memory>
+#include <thread>
+
+namespace safl {
+
+/**
+ * @ingroup Exec
+ * @brief The executor which runs tasks in a pool of worker threads.
+ *
+ * Each worker owns a work-stealing deque. A task invoked from a worker thread,
+ * e.g. a continuation, is put into a LIFO slot of that worker and is the next
+ * one to run, so a chain of continuations stays on the same core. The previous
+ * occupant of the slot is pushed to the deque, from where idle workers steal
+ * it. Idle workers take the slot itself only when all deques are empty, e.g.
+ * when its worker is blocked in a task. Tasks invoked from other threads are
+ * injected into a shared queue.
+ * Workers without work park until new tasks arrive.
+ *
+ * Continuations of independent chains run in parallel. The executor drains all
+ * queued tasks before it is destroyed.
+ */
+class ThreadPoolExecutor final
+        : public Executor
+{
+public:
+    explicit ThreadPoolExecutor(
+            std::size_t cntWorkers = std::thread::hardware_concurrency());
+    ~ThreadPoolExecutor() noexcept;
+
+    void invoke(Task &&task) noexcept override;
+    void schedule(TaskNode *node) noexcept override;
+    bool isInExecutorThread() const noexcept override;
+
+    std::size_t size() const noexcept;
+
+private:
+    class Pool;
+    std::unique_ptr<Pool> m_pool;
+};
+
+} // namespace safl
@@ -0,0 +1,138 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Std includes:
+#include <cstddef>
+#include <new>
+
+/* The build of the library decides whether memory resources are supported,
+ * so the library and its users agree on its ABI whatever language standard
+ * they are compiled with. Builds without CMake detect the support in each
+ * translation unit, so they must use the same standard everywhere. */
+#ifndef SAFL_HAS_MEMORY_RESOURCE
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && __cplusplus >= 201703L
+#define SAFL_HAS_MEMORY_RESOURCE 1
+#endif
+#endif
+#endif
+
+#ifndef SAFL_HAS_MEMORY_RESOURCE
+#define SAFL_HAS_MEMORY_RESOURCE 0
+#endif
+
+#if SAFL_HAS_MEMORY_RESOURCE
+#include <memory_resource>
+#endif
+
+namespace safl {
+namespace detail {
+
+#if SAFL_HAS_MEMORY_RESOURCE
+/* Each object is preceded by a header which keeps the memory resource it was
+ * allocated from. */
+constexpr std::size_t c_allocationHeaderSize = alignof(std::max_align_t);
+
+std::pmr::memory_resource *currentMemoryResource() noexcept;
+void setCurrentMemoryResource(std::pmr::memory_resource *resource) noexcept;
+std::pmr::memory_resource *memoryResourceOf(const void *object) noexcept;
+
+/**
+ * @internal
+ * @brief Make the calling thread allocate from the resource of an object.
+ *
+ * Objects which were not allocated from a memory resource do not change the
+ * current one.
+ */
+class InheritedMemoryResource
+{
+public:
+    explicit InheritedMemoryResource(const void *object) noexcept
+        : m_oldResource(currentMemoryResource())
+    {
+        if ( auto *resource = memoryResourceOf(object) ) {
+            setCurrentMemoryResource(resource);
+        }
+    }
+
+    ~InheritedMemoryResource()
+    {
+        setCurrentMemoryResource(m_oldResource);
+    }
+
+    InheritedMemoryResource(const InheritedMemoryResource &) = delete;
+    InheritedMemoryResource &operator=(const InheritedMemoryResource &) = delete;
+
+private:
+    std::pmr::memory_resource *m_oldResource;
+};
+#else
+constexpr std::size_t c_allocationHeaderSize = 0;
+
+class InheritedMemoryResource
+{
+public:
+    explicit InheritedMemoryResource(const void */*object*/) noexcept
+    {
+    }
+};
+#endif
+
+void *allocate(std::size_t size, bool isPooled);
+void deallocate(void *ptr, std::size_t size, bool isPooled) noexcept;
+
+/**
+ * @internal
+ * @brief The base class for objects which safl allocates on the heap.
+ *
+ * Objects are allocated from the current memory resource of the thread, if
+ * any. Otherwise, pooled objects come from the ContextPool, and others from
+ * the global allocator.
+ */
+template<bool tIsPooled>
+class Allocated
+{
+public:
+    static void *operator new(std::size_t size)
+    {
+        return allocate(size, tIsPooled);
+    }
+
+    static void operator delete(void *ptr, std::size_t size) noexcept
+    {
+        deallocate(ptr, size, tIsPooled);
+    }
+
+    static void *operator new(std::size_t /*size*/, void *ptr) noexcept
+    {
+        return ptr;
+    }
+
+    static void operator delete(void */*ptr*/, void */*place*/) noexcept
+    {
+    }
+
+#ifdef __cpp_aligned_new
+    /* Over-aligned objects always use the global allocator. */
+    static void *operator new(std::size_t size, std::align_val_t alignment)
+    {
+        return ::operator new(size, alignment);
+    }
+
+    static void operator delete(void *ptr, std::size_t /*size*/,
+                                std::align_val_t alignment) noexcept
+    {
+        ::operator delete(ptr, alignment);
+    }
+#endif
+
+protected:
+    Allocated() = default;
+    ~Allocated() = default;
+};
+
+} // namespace detail
+} // namespace safl
@@ -0,0 +1,56 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Local includes:
+#include "TaskNode.h"
+
+// Std includes:
+#include <atomic>
+
+namespace safl {
+namespace detail {
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief A lock-free intrusive queue of nodes, with many producers and a
+ * single consumer.
+ *
+ * This is the queue by Dmitry Vyukov. Producers exchange the head, so push()
+ * is wait-free and can be called from any thread. The consumer owns the tail.
+ * A node is popped only after its producer has linked it, so pop() may find
+ * nothing while isEmpty() is false.
+ */
+class ConcurrentTaskQueue
+{
+public:
+    ConcurrentTaskQueue() noexcept;
+    ConcurrentTaskQueue(const ConcurrentTaskQueue &) = delete;
+    ConcurrentTaskQueue &operator=(const ConcurrentTaskQueue &) = delete;
+
+    void push(TaskNode *node) noexcept;
+
+    /* Used by the consumer only. */
+    TaskNode *pop() noexcept;
+    bool isEmpty() const noexcept;
+
+private:
+    class Stub final
+            : public TaskNode
+    {
+        void run() noexcept override
+        {
+        }
+    };
+
+private:
+    std::atomic<TaskNode*> m_head;
+    TaskNode *m_tail;
+    Stub m_stub;
+};
+
+} // namespace detail
+} // namespace safl
@@ -5,17 +5,25 @@
 #pragma once
 
 // Local includes:
+#include "../Executor.h"
+#include "Allocation.h"
 #include "DebugContext.h"
 #include "Signalling.h"
+#include "TaskNode.h"
+#include "Timer.h"
 
 // Std includes:
+#include <atomic>
+#include <cassert>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
 #include <vector>
-#include <set>
 
 namespace safl {
 
-template<typename tValueType>
+template<typename tValueType, typename... tErrors>
 class Future;
 
 namespace detail {
@@ -28,26 +36,107 @@ class SyncNextContext;
 template<typename tValueType, typename tFunc, typename tInputType>
 class AsyncNextContext;
 
+template<typename tValueType, typename tContext>
+class FusibleFuture;
+
+template<typename tValueType, typename tFunc, typename... tErrors>
+class ErrorSetHandlerContext;
+
 /*******************************************************************************
  * Base classes for contexts.
  */
 
+class ContextNtBase;
+
+/**
+ * @internal
+ * @brief The previous contexts of a context.
+ *
+ * Nearly every context has a single previous context, which is kept inline.
+ * Only fan-in contexts spill them into an array, where each previous context
+ * keeps the index of its slot, i.e. the order in which it was added. Removed
+ * contexts leave empty slots, which are skipped by iteration. Contexts with
+ * a fixed number of inputs may lend the array, so nothing is allocated.
+ */
+class PrevList
+{
+public:
+    PrevList() = default;
+    PrevList(const PrevList&) = delete;
+    PrevList &operator=(const PrevList&) = delete;
+    ~PrevList();
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_slots != nullptr ? m_cntSpilled : (m_single != nullptr ? 1u : 0u);
+    }
+
+    ContextNtBase *front() const noexcept;
+
+    ContextNtBase *const *begin() const noexcept
+    {
+        return m_slots != nullptr ? m_slots : &m_single;
+    }
+
+    ContextNtBase *const *end() const noexcept
+    {
+        return m_slots != nullptr ? m_slots + m_cntSlots : &m_single + 1;
+    }
+
+    static std::size_t indexOf(const ContextNtBase *prev) noexcept;
+
+    bool contains(const ContextNtBase *prev) const noexcept;
+    void reserve(std::size_t cnt);
+    void lend(ContextNtBase **slots, std::size_t cnt) noexcept;
+    void insert(ContextNtBase *prev);
+    void erase(ContextNtBase *prev) noexcept;
+
+private:
+    void spill(std::size_t cnt);
+
+private:
+    ContextNtBase *m_single = nullptr;
+    ContextNtBase **m_slots = nullptr;
+    unsigned int m_cntSlots = 0;
+    unsigned int m_capacity = 0;
+    unsigned int m_cntSpilled = 0;
+    bool m_isLent = false;
+};
+
 class ContextNtBase
-        : private UniqueInstance
+        : public TaskNode
+        , public Allocated<true>
+        , private UniqueInstance
 #ifdef SAFL_DEVELOPER
         , public DebugContext
 #endif
 {
 public:
     bool isReady() const;
+    bool hasResult() const;
     bool isFulfillable() const;
     void setValue();
     void makeShadowOf(ContextNtBase *next);
     void setTarget(ContextNtBase *next, bool doMakeDirect = false);
+    void bindTo(Executor *executor) noexcept;
+    Executor *boundExecutor() const noexcept;
+    const void *allocation() const noexcept;
+    void setContinuationPolicy(ContinuationPolicy policy) noexcept;
     void attachPromise();
     void detachPromise();
     void attachFuture();
     void detachFuture(bool doTryDestroy = true);
+    bool isValueShared() const noexcept;
+    ContextNtBase *tryDetachInput();
+    void replaceInput(ContextNtBase *input, ContextNtBase *ctx);
+    bool tryDetachFromTarget(const Signal *stopMessage);
+    void cancel() noexcept;
+    bool isCancelled() const noexcept;
 
 public:
     template<typename tFunc>
@@ -56,42 +145,134 @@ public:
         addMessageHandler(makeMessageHandler(std::forward<tFunc>(f)));
     }
 
+    template<typename tFunc>
+    void onLatestMessage(tFunc &&f)
+    {
+        addMessageHandler(makeMessageHandler(std::forward<tFunc>(f), true));
+    }
+
+    template<typename tFunc>
+    void onCancel(tFunc &&f)
+    {
+        addCancelHandler(Task(std::forward<tFunc>(f)));
+    }
+
     template<typename tMessage>
     void sendMessage(tMessage &&msg)
     {
-        acceptMessage(makeSignal(std::forward<tMessage>(msg)));
+        routeMessage(makeSignal(std::forward<tMessage>(msg)));
+    }
+
+    /* Progress handlers are kept by the operation which currently runs, and
+     * run in the executor of this context. */
+    template<typename tFunc>
+    void onProgress(tFunc &&f)
+    {
+        if ( ContextNtBase *route = messageRoute() ) {
+            route->addProgressHandler(makeMessageHandler(std::forward<tFunc>(f), true),
+                                      m_executor);
+        }
+    }
+
+    template<typename tProgress>
+    void reportProgress(tProgress &&progress)
+    {
+        acceptProgress(makeSignal(std::forward<tProgress>(progress)));
     }
 
+protected:
+    /* The state word. Flags below the pending counter describe the result and
+     * the owners of the context. The context is destroyed as soon as it has
+     * no owners, i.e. neither a promise, nor a future, nor a target, nor
+     * previous contexts, nor a pending task. */
+    using State = unsigned int;
+    enum : State
+    {
+        ValueSet       = 1u << 0,
+        ErrorSet       = 1u << 1,
+        ErrorForwarded = 1u << 2,
+        Shadow         = 1u << 3,
+        HasFuture      = 1u << 4,
+        HasPromise     = 1u << 5,
+        HasTarget      = 1u << 6,
+        HasPrev        = 1u << 7,
+        Bound          = 1u << 8,
+        InlinePolicy   = 1u << 9,
+        PostPolicy     = 1u << 10,
+        Cancelled      = 1u << 11,
+        ErrorKept      = 1u << 12,
+        PendingTask    = 1u << 13,
+        PendingMask    = ~(PendingTask - 1),
+        OwnerMask      = HasFuture | HasPromise | HasTarget | HasPrev | PendingMask
+    };
+
 protected:
     ContextNtBase();
     virtual ~ContextNtBase();
+    bool hasState(State mask) const noexcept;
+    void publishError(Signal &&error);
+    void publishKeptError();
     void storeError(Signal &&error);
     void addErrorHandler(SignalHandler &&handler);
+    void acquire(State owner) noexcept;
+    void release(State owner);
     bool tryHandleSignal(Signal &sig, SignalHandler &handler);
     bool tryHandleSignal(Signal &sig, std::vector<SignalHandler> &handlers);
+    void dispatchMessage(Executor *executor, SignalHandlerNtBase *handler,
+                         Signal &&msg) noexcept;
+    void routeMessage(Signal &&msg) noexcept;
+
+    bool abandonPrevs() noexcept;
+
+    /* Contexts which handle messages, or pass them to their inputs
+     * themselves, are the ends of message routes. */
+    virtual bool handlesMessages() const noexcept;
+    virtual void acceptMessage(Signal &&msg) noexcept;
+    virtual void addPrev(ContextNtBase *prev);
+    virtual void removePrev(ContextNtBase *prev);
+    virtual void forgetPrev(ContextNtBase *prev) noexcept;
+    virtual void acceptCancel() noexcept;
+    virtual bool runsContinuation() const noexcept;
 
 private:
+    ContextNtBase *messageRoute() const noexcept;
+    void updateRoute() noexcept;
     void fulfil();
+    bool isInlined() const noexcept;
+    void run() noexcept override;
     void forwardError(Signal &&error);
+    void storeKeptError();
 
-    virtual void acceptMessage(Signal &&msg) noexcept;
     virtual void addMessageHandler(SignalHandler &&handler);
+    virtual void addCancelHandler(Task &&handler);
+    virtual void addProgressHandler(SignalHandler &&handler, Executor *executor);
+    virtual void acceptProgress(Signal &&progress) noexcept;
 
     virtual void acceptError(ContextNtBase *ctx, Signal &&error) noexcept;
 
+    /* Contexts of a static set of errors keep the error in their own slot,
+     * see ErrorSetContextBase. This is the signal which hands it over. */
+    virtual Signal releaseKeptError() noexcept;
+
     virtual void acceptInput(ContextNtBase *ctx);
 
     void unsetTarget();
-    void tryDestroy();
 
 protected:
-    std::set<ContextNtBase*> m_prev;
+    PrevList m_prev;
     ContextNtBase *m_next;
-    bool m_isValueSet;
-    bool m_isErrorForwarded;
-    bool m_isShadow;
-    bool m_hasFuture;
-    bool m_hasPromise;
+    Executor *m_executor;
+    std::atomic<State> m_state;
+
+private:
+    friend class PrevList;
+
+    /* The index of the slot of this context among the previous contexts of its
+     * target. */
+    unsigned int m_prevIndex = 0;
+
+    /* The context which messages sent to this one go to. */
+    std::atomic<ContextNtBase*> m_route{nullptr};
 
 private: // error handling
     Signal m_storedError;
@@ -105,7 +286,7 @@ class ContextValueBase
 public:
     ~ContextValueBase()
     {
-        if ( m_isValueSet ) {
+        if ( this->hasState(ValueSet) ) {
             reinterpret_cast<tValueType*>(&m_value)->~tValueType();
         }
     }
@@ -115,6 +296,11 @@ public:
         return *reinterpret_cast<const tValueType*>(&m_value);
     }
 
+    tValueType &mutableValue() noexcept
+    {
+        return *reinterpret_cast<tValueType*>(&m_value);
+    }
+
     void setValue(const tValueType &value) noexcept
     {
         DLOG(">> setValue: " << value);
@@ -123,61 +309,190 @@ public:
         DLOG("<< setValue");
     }
 
+    void setValue(tValueType &&value) noexcept
+    {
+        DLOG(">> setValue (move)");
+        new (&m_value) tValueType(std::move(value));
+        ContextNtBase::setValue();
+        DLOG("<< setValue (move)");
+    }
+
+    template<typename... tArgs>
+    void emplaceValue(tArgs &&...args) noexcept
+    {
+        DLOG(">> emplaceValue");
+        new (&m_value) tValueType(std::forward<tArgs>(args)...);
+        ContextNtBase::setValue();
+        DLOG("<< emplaceValue");
+    }
+
 private:
     std::aligned_storage_t<sizeof(tValueType)> m_value;
 };
 
+/* Pass a value to a callable. A constant value is copied only if the callable
+ * does not accept a constant reference. */
+template<typename tFunc, typename tValue>
+decltype(auto) passValue(tFunc &f, tValue &&value,
+                         std::enable_if_t<!std::is_reference<tValue>::value> * = nullptr)
+{
+    return f(std::move(value));
+}
+
+template<typename tFunc, typename tValue>
+decltype(auto) passConstValue(tFunc &f, const tValue &value, std::true_type)
+{
+    return f(value);
+}
+
+template<typename tFunc, typename tValue>
+decltype(auto) passConstValue(tFunc &f, const tValue &value, std::false_type)
+{
+    return f(tValue(value));
+}
+
+template<typename tFunc, typename tValue>
+decltype(auto) passValue(tFunc &f, const tValue &value)
+{
+    return passConstValue(f, value, IsCallableWith<tFunc, const tValue&>{});
+}
+
+/* std::is_copy_constructible, which also sees through vectors and tuples of
+ * collect(). */
+template<typename tValue>
+struct IsCopyable
+        : std::is_copy_constructible<tValue>
+{
+};
+
+template<typename tValue, typename tAllocator>
+struct IsCopyable<std::vector<tValue, tAllocator>>
+        : IsCopyable<tValue>
+{
+};
+
+template<typename... tValues>
+struct IsCopyable<std::tuple<tValues...>>
+        : std::is_same<std::integer_sequence<bool, true, IsCopyable<tValues>::value...>,
+                       std::integer_sequence<bool, IsCopyable<tValues>::value..., true>>
+{
+};
+
+/* Pass the value of a context to a continuation. The value is moved, unless
+ * the future of the context may still read it. Values which cannot be copied
+ * are always moved, so the future is left with a moved-from value. */
+template<typename tFunc, typename tInput>
+decltype(auto) passValueOf(tFunc &f, ContextValueBase<tInput> *ctx, std::true_type)
+{
+    if ( ctx->isValueShared() ) {
+        return passValue(f, ctx->value());
+    }
+    return passValue(f, std::move(ctx->mutableValue()));
+}
+
+template<typename tFunc, typename tInput>
+decltype(auto) passValueOf(tFunc &f, ContextValueBase<tInput> *ctx, std::false_type)
+{
+    return passValue(f, std::move(ctx->mutableValue()));
+}
+
+template<typename tFunc, typename tInput>
+decltype(auto) passValueOf(tFunc &f, ContextValueBase<tInput> *ctx)
+{
+    return passValueOf(f, ctx, IsCopyable<tInput>{});
+}
+
 template<>
 class ContextValueBase<void>
         : public ContextNtBase
 {
 };
 
+/* The continuation which passes its input through, used to change executors. */
+template<typename tValueType>
+struct Forward
+{
+    tValueType operator()(tValueType &&value) const
+    {
+        return std::move(value);
+    }
+};
+
+template<>
+struct Forward<void>
+{
+    void operator()() const
+    {
+    }
+};
+
+template<typename tValueType, typename tFunc>
+struct ThenTraits
+{
+    using Traits = FunctionTraits<tFunc>;
+
+    static_assert(Traits::NrArgs::value ==
+                  (std::is_same<tValueType, void>::value ? 0 : 1),
+                  "then() handler for a void Future must not accept arguments, "
+                  "and for other types of Future it must accept exactly one argument");
+
+    /* If tFunc() returns Future<X>, then() also returns Future<X>.
+     * Else, if tFunc() returns X, then() still returns Future<X>. */
+    using FuncReturnType = typename Traits::ReturnType;
+    using DoesFuncReturnFuture = std::is_base_of<FutureNtBase, FuncReturnType>;
+    using FutureType = std::conditional_t<DoesFuncReturnFuture::value,
+                                          FuncReturnType, Future<FuncReturnType>>;
+    using ValueType = typename FutureType::ValueType;
+
+    /* Synchronous (i.e. returning X) and asynchronous (i.e. returning Future<X>)
+     * callables must be handled differently. */
+    template<typename xValueType, typename xFunc, typename xInputType>
+    using NextContextType = std::conditional_t<DoesFuncReturnFuture::value,
+                                               AsyncNextContext<xValueType, xFunc, xInputType>,
+                                               SyncNextContext<xValueType, xFunc, xInputType>>;
+
+    /* The future of a synchronous continuation can fuse the next one. */
+    template<typename xContext>
+    using ResultType = std::conditional_t<DoesFuncReturnFuture::value,
+                                          FutureType, FusibleFuture<ValueType, xContext>>;
+};
+
 template<typename tValueType>
 class ContextBase
         : public ContextValueBase<tValueType>
 {
-    template<typename tFunc>
-    struct ThenTraits
-    {
-        using Traits = FunctionTraits<tFunc>;
-
-        static_assert(Traits::NrArgs::value ==
-                      (std::is_same<tValueType, void>::value ? 0 : 1),
-                      "then() handler for a void Future must not accept arguments, "
-                      "and for other types of Future it must accept exactly one argument");
-
-        /* If tFunc() returns Future<X>, then() also returns Future<X>.
-         * Else, if tFunc() returns X, then() still returns Future<X>. */
-        using FuncReturnType = typename Traits::ReturnType;
-        using DoesFuncReturnFuture = std::is_base_of<FutureNtBase, FuncReturnType>;
-        using FutureType = std::conditional_t<DoesFuncReturnFuture::value,
-                                              FuncReturnType, Future<FuncReturnType>>;
-        using ValueType = typename FutureType::ValueType;
-
-        /* Synchronous (i.e. returning X) and asynchronous (i.e. returning Future<X>)
-         * callables must be handled differently. */
-        template<typename xValueType, typename xFunc, typename xInputType>
-        using NextContextType = std::conditional_t<DoesFuncReturnFuture::value,
-                                                   AsyncNextContext<xValueType, xFunc, xInputType>,
-                                                   SyncNextContext<xValueType, xFunc, xInputType>>;
-    };
-
 public:
     template<typename tFunc>
     auto then(tFunc &&f)
     {
-        using Then = ThenTraits<tFunc>;
+        /* Continuations of a bound context stay in its executor. */
+        return then(this->boundExecutor(), std::forward<tFunc>(f));
+    }
+
+    template<typename tFunc>
+    auto then(Executor *executor, tFunc &&f,
+              ContinuationPolicy policy = ContinuationPolicy::Default)
+    {
+        using Then = ThenTraits<tValueType, tFunc>;
+        using NextContext = typename Then::template NextContextType
+                <typename Then::ValueType, tFunc, tValueType>;
 
         DLOG(">> then");
-        auto nextCtx = new typename Then::template NextContextType
-                <typename Then::ValueType, tFunc, tValueType>(std::forward<tFunc>(f));
-        typename Then::FutureType nextFuture(nextCtx);
+        InheritedMemoryResource resource(this->allocation());
+        auto nextCtx = new NextContext(std::forward<tFunc>(f));
+        nextCtx->bindTo(executor);
+        nextCtx->setContinuationPolicy(policy);
+        typename Then::template ResultType<NextContext> nextFuture(nextCtx);
         this->setTarget(nextCtx);
         DLOG("<< then");
         return nextFuture;
     }
 
+    auto via(Executor *executor)
+    {
+        return then(executor, Forward<tValueType>{});
+    }
+
     template<typename tFunc>
     void onError(tFunc &&f)
     {
@@ -189,23 +504,131 @@ public:
     void setError(tErrorType &&error)
     {
         DLOG(">> setError");
-        this->storeError(makeSignal(std::forward<tErrorType>(error)));
+        this->publishError(makeSignal(std::forward<tErrorType>(error)));
         DLOG("<< setError");
     }
 };
 
+/* The base of contexts which fail only with the errors of a static set,
+ * besides errors like BrokenPromise which come from the context graph. An
+ * error of the set is kept in the slot of the context and handed over as
+ * is to a handler of the set. Other targets, which do not know the set, get
+ * it as a signal. */
+template<typename tValueType, typename... tErrors>
+class ErrorSetContextBase
+        : public ContextBase<tValueType>
+{
+public:
+    ErrorSlot<tErrors...> &error() noexcept
+    {
+        return m_error;
+    }
+
+    template<typename tErrorType>
+    void setTypedError(tErrorType &&error)
+    {
+        DLOG(">> setTypedError");
+        m_error.template emplace<std::decay_t<tErrorType>>(std::forward<tErrorType>(error));
+        this->publishKeptError();
+        DLOG("<< setTypedError");
+    }
+
+    template<typename tFunc>
+    auto onErrorOf(tFunc &&f)
+    {
+        using HandlerContext = ErrorSetHandlerContext<tValueType, tFunc, tErrors...>;
+
+        DLOG(">> onErrorOf");
+        InheritedMemoryResource resource(this->allocation());
+        auto handlerCtx = new HandlerContext(std::forward<tFunc>(f));
+        handlerCtx->bindTo(this->boundExecutor());
+        typename HandlerContext::FutureType handlerFuture(handlerCtx);
+        m_hasHandlerTarget = true;
+        this->setTarget(handlerCtx);
+        DLOG("<< onErrorOf");
+        return handlerFuture;
+    }
+
+private:
+    Signal releaseKeptError() noexcept override
+    {
+        Signal sig;
+        if ( !m_hasHandlerTarget ) {
+            m_error.visit([this, &sig](auto index)
+            {
+                sig = makeSignal(std::move(m_error.template get<decltype(index)::value>()));
+            });
+        }
+        return sig;
+    }
+
+private:
+    ErrorSlot<tErrors...> m_error;
+    bool m_hasHandlerTarget = false;
+};
+
+/* Contexts with an empty set of errors are plain ones. */
+template<typename tValueType, typename... tErrors>
+using ErrorSetContextType = std::conditional_t<sizeof...(tErrors) == 0,
+                                               ContextBase<tValueType>,
+                                               ErrorSetContextBase<tValueType, tErrors...>>;
+
 /*******************************************************************************
  * Concrete future contexts.
  */
 
-template<typename tValue>
+template<typename tValue, typename... tErrors>
 class InitialContext final
-        : public ContextBase<tValue>
+        : public ErrorSetContextType<tValue, tErrors...>
 {
+public:
+    ~InitialContext()
+    {
+        delete takeCancelHandlers();
+        delete m_progressHandlers.load(std::memory_order_acquire);
+    }
+
 private:
+    /* Cancel handlers are kept in a lock-free list, because the promise and
+     * the consumer may be in different threads. */
+    struct CancelHandler
+    {
+        ~CancelHandler()
+        {
+            delete next;
+        }
+
+        Task task;
+        CancelHandler *next;
+    };
+
+    /* Progress handlers are added by consumers, which may be in other threads
+     * than the promise, and are never removed. */
+    struct ProgressHandler
+    {
+        ~ProgressHandler()
+        {
+            delete next;
+        }
+
+        SignalHandler handler;
+        Executor *executor;
+        ProgressHandler *next;
+    };
+
+    bool handlesMessages() const noexcept override
+    {
+        return true;
+    }
+
     void acceptMessage(Signal &&msg) noexcept override
     {
-        this->tryHandleSignal(msg, m_messageHandlers);
+        for ( auto &handler : m_messageHandlers ) {
+            if ( handler->isType(msg->type()) ) {
+                this->dispatchMessage(this->m_executor, handler.get(), std::move(msg));
+                return;
+            }
+        }
     }
 
     void addMessageHandler(SignalHandler &&handler) override
@@ -213,8 +636,128 @@ private:
         m_messageHandlers.push_back(std::move(handler));
     }
 
+    void addProgressHandler(SignalHandler &&handler, Executor *executor) override
+    {
+        auto *node = new ProgressHandler{std::move(handler), executor,
+                                         m_progressHandlers.load()};
+        while ( !m_progressHandlers.compare_exchange_weak(node->next, node) ) {
+        }
+    }
+
+    void acceptProgress(Signal &&progress) noexcept override
+    {
+        /* Each handler takes the latest progress, once per run of its
+         * executor, however often the progress is reported. */
+        ProgressHandler *node = m_progressHandlers.load(std::memory_order_acquire);
+        for ( ; node != nullptr; node = node->next ) {
+            if ( node->handler->isType(progress->type()) ) {
+                this->dispatchMessage(node->executor, node->handler.get(), progress.share());
+            }
+        }
+    }
+
+    void addCancelHandler(Task &&handler) override
+    {
+        auto *node = new CancelHandler{std::move(handler), m_cancelHandlers.load()};
+        while ( !m_cancelHandlers.compare_exchange_weak(node->next, node) ) {
+        }
+
+        /* Either this or the cancelling thread sees the handler. */
+        if ( this->isCancelled() ) {
+            invokeCancelHandlers();
+        }
+    }
+
+    void acceptCancel() noexcept override
+    {
+        DLOG("@@ cancelled");
+        invokeCancelHandlers();
+    }
+
+    void invokeCancelHandlers() noexcept
+    {
+        CancelHandler *list = takeCancelHandlers();
+        for ( CancelHandler *node = list; node != nullptr; node = node->next ) {
+            this->m_executor->invoke(std::move(node->task));
+        }
+        delete list;
+    }
+
+    CancelHandler *takeCancelHandlers() noexcept
+    {
+        return m_cancelHandlers.exchange(nullptr);
+    }
+
 private:
     std::vector<SignalHandler> m_messageHandlers;
+    std::atomic<CancelHandler*> m_cancelHandlers{nullptr};
+    std::atomic<ProgressHandler*> m_progressHandlers{nullptr};
+};
+
+/* The base of contexts with many inputs, or which abandon their input. The
+ * list of inputs is guarded, because they are removed concurrently and
+ * messages must not reach removed ones. */
+template<typename tValue>
+class FanInContext
+        : public ContextBase<tValue>
+{
+public:
+    bool handlesMessages() const noexcept override
+    {
+        return true;
+    }
+
+    void acceptMessage(Signal &&msg) noexcept override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ContextNtBase::acceptMessage(std::move(msg));
+    }
+
+    void addPrev(ContextNtBase *prev) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ContextNtBase::addPrev(prev);
+    }
+
+    void removePrev(ContextNtBase *prev) override
+    {
+        /* The context may be destroyed when the last input is removed, so
+         * the lock must be released before. */
+        std::unique_lock<std::mutex> lock(m_mutex);
+        this->m_prev.erase(prev);
+        const bool isLast = this->m_prev.empty();
+        lock.unlock();
+        if ( isLast ) {
+            this->release(ContextNtBase::HasPrev);
+        }
+    }
+
+    void acceptCancel() noexcept override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const bool isLast = this->abandonPrevs();
+        lock.unlock();
+        if ( isLast ) {
+            this->release(ContextNtBase::HasPrev);
+        }
+    }
+
+protected:
+    /* Each input gets the slot of its position. */
+    template<typename tInput>
+    void attachAll(std::vector<Future<tInput>> &futures) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            this->m_prev.reserve(futures.size());
+        }
+        for ( auto &future : futures ) {
+            future.takeContext()->setTarget(this, true);
+        }
+    }
+
+protected:
+    std::mutex m_mutex;
 };
 
 template<typename tValue, typename tFunc, typename tInput>
@@ -227,6 +770,12 @@ public:
     {
     }
 
+protected:
+    bool runsContinuation() const noexcept override
+    {
+        return true;
+    }
+
 protected:
     std::decay_t<tFunc> m_f;
 };
@@ -243,6 +792,20 @@ class SyncNextContext final
 {
     using NextContextBase<tValue, tFunc, tInput>::NextContextBase;
 
+public:
+    using FunctionType = std::decay_t<tFunc>;
+    using InputType = tInput;
+
+    bool canFuse() const noexcept
+    {
+        return true;
+    }
+
+    FunctionType &function() noexcept
+    {
+        return this->m_f;
+    }
+
 private:
     void acceptInput(ContextNtBase *ctx) noexcept override
     {
@@ -253,7 +816,7 @@ private:
     void acceptInput(CondContextType<true, true, xValue, xInput> ctx) noexcept
     {
         DLOG(">> acceptInput");
-        this->setValue(this->m_f(ctx->value()));
+        this->setValue(passValueOf(this->m_f, ctx));
         DLOG("<< acceptInput");
     }
 
@@ -261,7 +824,7 @@ private:
     void acceptInput(CondContextType<false, true, xValue, xInput> ctx) noexcept
     {
         DLOG(">> acceptInput (void output)");
-        this->m_f(ctx->value());
+        passValueOf(this->m_f, ctx);
         this->setValue();
         DLOG("<< acceptInput (void output)");
     }
@@ -301,11 +864,12 @@ private:
     {
         if ( m_shadow == nullptr ) {
             DLOG(">> acceptInput (create shadow)");
-            m_shadow = this->m_f(ctx->value()).makeShadowOf(this);
+            m_shadow = passValueOf(this->m_f, ctx).makeShadowOf(this);
             DLOG("<< acceptInput (create shadow)");
         } else {
             DLOG(">> acceptInput (process shadow)");
-            this->setValue(m_shadow->value());
+            /* Nothing else observes the shadow. */
+            this->setValue(std::move(m_shadow->mutableValue()));
             DLOG("<< acceptInput (process shadow)");
         }
     }
@@ -314,5 +878,331 @@ private:
     ContextBase<tValue> *m_shadow = nullptr;
 };
 
+/*******************************************************************************
+ * Handlers of a static set of errors.
+ */
+
+template<typename... tErrors>
+struct ErrorList
+{
+};
+
+/* The errors of a set which a handler does not accept. */
+template<typename tFunc, typename tUnhandled, typename... tErrors>
+struct UnhandledErrors
+{
+    using Type = tUnhandled;
+};
+
+template<typename tFunc, typename... tUnhandled, typename tError, typename... tErrors>
+struct UnhandledErrors<tFunc, ErrorList<tUnhandled...>, tError, tErrors...>
+        : UnhandledErrors<tFunc,
+                          std::conditional_t<IsCallableWith<tFunc, const tError&>::value,
+                                             ErrorList<tUnhandled...>,
+                                             ErrorList<tUnhandled..., tError>>,
+                          tErrors...>
+{
+};
+
+template<typename tValueType, typename tErrorList>
+struct ErrorListTraits;
+
+template<typename tValueType, typename... tErrors>
+struct ErrorListTraits<tValueType, ErrorList<tErrors...>>
+{
+    using ContextType = ErrorSetContextType<tValueType, tErrors...>;
+    using FutureType = Future<tValueType, tErrors...>;
+};
+
+template<typename tValueType, typename tFunc, typename... tErrors>
+using HandlerTraits = ErrorListTraits<
+        tValueType, typename UnhandledErrors<std::decay_t<tFunc>, ErrorList<>, tErrors...>::Type>;
+
+/* The handler of a static set of errors. It takes the error from the slot of
+ * its input, and calls the overload of the callable which is chosen at
+ * compile time. Values pass through, and so do errors which the callable
+ * does not accept, which stay in the set of this context. */
+template<typename tValueType, typename tFunc, typename... tErrors>
+class ErrorSetHandlerContext final
+        : public HandlerTraits<tValueType, tFunc, tErrors...>::ContextType
+{
+    template<typename tError>
+    using IsHandled = typename IsCallableWith<std::decay_t<tFunc>, const tError&>::type;
+
+    static_assert(IsOneOf<std::true_type, IsHandled<tErrors>...>::value,
+                  "error handler must accept at least one of the errors of the future");
+
+public:
+    using FutureType = typename HandlerTraits<tValueType, tFunc, tErrors...>::FutureType;
+
+public:
+    explicit ErrorSetHandlerContext(tFunc &&f)
+        : m_f(std::forward<tFunc>(f))
+    {
+    }
+
+private:
+    bool runsContinuation() const noexcept override
+    {
+        return true;
+    }
+
+    void acceptInput(ContextNtBase *ctx) noexcept override
+    {
+        passInput(static_cast<ContextValueBase<tValueType>*>(ctx),
+                  std::is_void<tValueType>{});
+    }
+
+    void passInput(ContextValueBase<tValueType> */*ctx*/, std::true_type) noexcept
+    {
+        this->setValue();
+    }
+
+    void passInput(ContextValueBase<tValueType> *ctx, std::false_type) noexcept
+    {
+        Forward<tValueType> forward;
+        this->setValue(passValueOf(forward, ctx));
+    }
+
+    void acceptError(ContextNtBase *ctx, Signal &&error) noexcept override
+    {
+        assert(this->m_prev.contains(ctx));
+
+        /* Errors out of the set pass on as they are. */
+        if ( error ) {
+            this->publishError(std::move(error));
+            return;
+        }
+
+        /* The input is disconnected once this returns, so the error is moved
+         * out of its slot. The handler runs in the executor of this context,
+         * and the task which runs it fits in place. */
+        m_input.takeFrom(static_cast<ErrorSetContextBase<tValueType, tErrors...>*>(ctx)->error());
+        this->acquire(ContextNtBase::PendingTask);
+        this->m_executor->invoke([this]()
+        {
+            m_input.visit([this](auto index)
+            {
+                using Error = typename ErrorSlot<tErrors...>::template ErrorType<decltype(index)::value>;
+                handleError(m_input.template get<decltype(index)::value>(), IsHandled<Error>{});
+            });
+            this->release(ContextNtBase::PendingTask);
+        });
+    }
+
+    template<typename tError>
+    void handleError(tError &error, std::true_type)
+    {
+        static_assert(std::is_same<decltype(m_f(static_cast<const tError&>(error))),
+                                   tValueType>::value,
+                      "error handler must return the same type as the corresponding future");
+        setValueOf(static_cast<const tError&>(error), std::is_void<tValueType>{});
+    }
+
+    template<typename tError>
+    void handleError(tError &error, std::false_type)
+    {
+        this->setTypedError(std::move(error));
+    }
+
+    template<typename tError>
+    void setValueOf(const tError &error, std::true_type)
+    {
+        m_f(error);
+        this->setValue();
+    }
+
+    template<typename tError>
+    void setValueOf(const tError &error, std::false_type)
+    {
+        this->setValue(m_f(error));
+    }
+
+private:
+    std::decay_t<tFunc> m_f;
+    ErrorSlot<tErrors...> m_input;
+};
+
+/*******************************************************************************
+ * Fused synchronous continuations.
+ */
+
+/* Call a callable with the value of a context. */
+template<typename tInput, typename tFunc>
+decltype(auto) applyTo(tFunc &f, ContextNtBase *ctx,
+                       std::enable_if_t<!std::is_void<tInput>::value> * = nullptr)
+{
+    return passValueOf(f, static_cast<ContextValueBase<tInput>*>(ctx));
+}
+
+template<typename tInput, typename tFunc>
+decltype(auto) applyTo(tFunc &f, ContextNtBase */*ctx*/,
+                       std::enable_if_t<std::is_void<tInput>::value> * = nullptr)
+{
+    return f();
+}
+
+/* Pass the result of the first stage to the second one. */
+template<typename tMiddle>
+struct Pipe
+{
+    template<typename tSecond, typename tFirstStage>
+    static decltype(auto) run(tSecond &second, tFirstStage &&firstStage)
+    {
+        return second(firstStage());
+    }
+};
+
+template<>
+struct Pipe<void>
+{
+    template<typename tSecond, typename tFirstStage>
+    static decltype(auto) run(tSecond &second, tFirstStage &&firstStage)
+    {
+        firstStage();
+        return second();
+    }
+};
+
+/* The composition of consecutive synchronous continuations, which takes
+ * tInput and passes tMiddle from the first one to the second one. If the
+ * first one could not be fused, because its input had already arrived, the
+ * composition keeps the second one only, and gets tMiddle as its input. */
+template<typename tFirst, typename tSecond, typename tInput, typename tMiddle>
+class Composition
+{
+public:
+    using InputType = tInput;
+    using ReturnType = typename FunctionTraits<tSecond>::ReturnType;
+
+public:
+    template<typename xSecond>
+    Composition(tFirst &&first, xSecond &&second)
+        : m_hasFirst(true)
+        , m_second(std::forward<xSecond>(second))
+    {
+        new (&m_first) tFirst(std::move(first));
+    }
+
+    template<typename xSecond>
+    explicit Composition(xSecond &&second)
+        : m_hasFirst(false)
+        , m_second(std::forward<xSecond>(second))
+    {
+    }
+
+    Composition(Composition &&other)
+        : m_hasFirst(other.m_hasFirst)
+        , m_second(std::move(other.m_second))
+    {
+        if ( m_hasFirst ) {
+            new (&m_first) tFirst(std::move(other.first()));
+        }
+    }
+
+    ~Composition()
+    {
+        if ( m_hasFirst ) {
+            first().~tFirst();
+        }
+    }
+
+    bool hasFirst() const noexcept
+    {
+        return m_hasFirst;
+    }
+
+    template<typename xInput,
+             typename = std::enable_if_t<std::is_same<std::decay_t<xInput>, tInput>::value>>
+    ReturnType operator()(xInput &&input)
+    {
+        assert(m_hasFirst);
+        return Pipe<tMiddle>::run(m_second, [&]() -> tMiddle
+        {
+            return passValue(first(), std::forward<xInput>(input));
+        });
+    }
+
+    ReturnType operator()()
+    {
+        assert(m_hasFirst);
+        return Pipe<tMiddle>::run(m_second, [&]() -> tMiddle
+        {
+            return first()();
+        });
+    }
+
+    ReturnType apply(ContextNtBase *ctx)
+    {
+        if ( m_hasFirst ) {
+            return applyTo<tInput>(*this, ctx);
+        }
+        return applyTo<tMiddle>(m_second, ctx);
+    }
+
+private:
+    tFirst &first() noexcept
+    {
+        return *reinterpret_cast<tFirst*>(&m_first);
+    }
+
+private:
+    bool m_hasFirst;
+    std::aligned_storage_t<sizeof(tFirst), alignof(tFirst)> m_first;
+    tSecond m_second;
+};
+
+template<typename tValue, typename tComposition>
+class FusedContext final
+        : public ContextBase<tValue>
+{
+public:
+    using FunctionType = tComposition;
+    using InputType = typename tComposition::InputType;
+
+public:
+    explicit FusedContext(tComposition &&f)
+        : m_f(std::move(f))
+    {
+    }
+
+    bool canFuse() const noexcept
+    {
+        return m_f.hasFirst();
+    }
+
+    FunctionType &function() noexcept
+    {
+        return m_f;
+    }
+
+private:
+    bool runsContinuation() const noexcept override
+    {
+        return true;
+    }
+
+    void acceptInput(ContextNtBase *ctx) noexcept override
+    {
+        DLOG(">> acceptInput (fused)");
+        acceptInput(ctx, std::is_void<tValue>{});
+        DLOG("<< acceptInput (fused)");
+    }
+
+    void acceptInput(ContextNtBase *ctx, std::false_type) noexcept
+    {
+        this->setValue(m_f.apply(ctx));
+    }
+
+    void acceptInput(ContextNtBase *ctx, std::true_type) noexcept
+    {
+        m_f.apply(ctx);
+        this->setValue();
+    }
+
+private:
+    tComposition m_f;
+};
+
 } // namespace detail
 } // namespace safl
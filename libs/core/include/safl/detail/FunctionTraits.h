@@ -5,6 +5,7 @@
 #pragma once
 
 // Std includes:
+#include <cstddef>
 #include <type_traits>
 #include <tuple>
 
@@ -81,5 +82,46 @@ struct FunctionTraits<tReturnType(tArgs...)>
 {
 };
 
+/* Check if a callable accepts an argument of the given type. */
+template<typename tFunc, typename tArg, typename = void>
+struct IsCallableWith
+        : std::false_type
+{
+};
+
+template<typename tFunc, typename tArg>
+struct IsCallableWith<tFunc, tArg,
+                      decltype(void(std::declval<tFunc&>()(std::declval<tArg>())))>
+        : std::true_type
+{
+};
+
+/* Check if a type is one of the given ones. */
+template<typename tType, typename... tTypes>
+struct IsOneOf
+        : std::false_type
+{
+};
+
+template<typename tType, typename tFirst, typename... tTypes>
+struct IsOneOf<tType, tFirst, tTypes...>
+        : std::conditional_t<std::is_same<tType, tFirst>::value,
+                             std::true_type, IsOneOf<tType, tTypes...>>
+{
+};
+
+/* The index of a type among the given ones, which must contain it. */
+template<typename tType, typename tFirst, typename... tTypes>
+struct IndexOf
+        : std::integral_constant<std::size_t, 1 + IndexOf<tType, tTypes...>::value>
+{
+};
+
+template<typename tType, typename... tTypes>
+struct IndexOf<tType, tType, tTypes...>
+        : std::integral_constant<std::size_t, 0>
+{
+};
+
 } // namespace detail
 } // namespace safl
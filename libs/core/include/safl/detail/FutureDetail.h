@@ -10,7 +10,7 @@
 
 namespace safl {
 
-template<typename tValueType>
+template<typename tValueType, typename... tErrors>
 class Promise;
 
 /**
@@ -45,16 +45,16 @@ protected:
     ~PromiseNtBase() = default;
 };
 
-template<typename tValueType>
+template<typename tValueType, typename... tErrors>
 class PromiseBase
         : public PromiseNtBase
 {
 public:
     using ValueType = tValueType;
-    using ContextType = ContextBase<tValueType>;
+    using ContextType = ErrorSetContextType<tValueType, tErrors...>;
 
 public:
-    Future<ValueType> future() const noexcept
+    Future<ValueType, tErrors...> future() const noexcept
     {
         return { m_ctx };
     }
@@ -62,22 +62,83 @@ public:
     template<typename tErrorType>
     void setError(tErrorType &&error) noexcept
     {
-        m_ctx->setError(std::forward<tErrorType>(error));
+        static_assert(sizeof...(tErrors) == 0 ||
+                      IsOneOf<std::decay_t<tErrorType>, tErrors...>::value,
+                      "error must be one of the errors of the promise");
+        setError(std::forward<tErrorType>(error),
+                 typename IsOneOf<std::decay_t<tErrorType>, tErrors...>::type{});
     }
 
     template<typename tFunc>
     auto &onMessage(tFunc &&f) noexcept
     {
         m_ctx->onMessage(std::forward<tFunc>(f));
-        return *static_cast<Promise<tValueType>*>(this);
+        return *static_cast<Promise<tValueType, tErrors...>*>(this);
+    }
+
+    /**
+     * @brief Specify a message handler which takes only the latest message.
+     *
+     * Messages which arrive while the handler is waiting to be invoked
+     * replace the pending one, e.g. for frequent priority updates.
+     */
+    template<typename tFunc>
+    auto &onLatestMessage(tFunc &&f) noexcept
+    {
+        m_ctx->onLatestMessage(std::forward<tFunc>(f));
+        return *static_cast<Promise<tValueType, tErrors...>*>(this);
+    }
+
+    /**
+     * @brief Report the progress of the operation to the consumers.
+     *
+     * Each handler specified with Future::onProgress() for this type of
+     * progress gets the latest one only, so progress may be reported as often
+     * as it changes. Progress which fits in place, e.g. a number, is never
+     * allocated.
+     */
+    template<typename tProgress>
+    void reportProgress(tProgress &&progress) noexcept
+    {
+        m_ctx->reportProgress(std::forward<tProgress>(progress));
+    }
+
+    /**
+     * @brief Specify a handler which is invoked when the result is not needed
+     * any more.
+     *
+     * This happens when all futures which wait for this promise are dropped
+     * or cancelled. The handler is invoked in the executor of the promise.
+     */
+    template<typename tFunc>
+    auto &onCancel(tFunc &&f) noexcept
+    {
+        m_ctx->onCancel(std::forward<tFunc>(f));
+        return *static_cast<Promise<tValueType, tErrors...>*>(this);
+    }
+
+    /**
+     * @brief Check if the result is not needed any more.
+     */
+    bool isCancelled() const noexcept
+    {
+        return m_ctx->isCancelled();
     }
 
 protected:
     PromiseBase() noexcept
-        : m_ctx(new InitialContext<tValueType>())
+        : m_ctx(new InitialContext<tValueType, tErrors...>())
+    {
+        m_ctx->attachPromise();
+    }
+
+#if SAFL_HAS_MEMORY_RESOURCE
+    explicit PromiseBase(std::pmr::memory_resource *resource) noexcept
+        : m_ctx(makeContext(resource))
     {
         m_ctx->attachPromise();
     }
+#endif
 
     PromiseBase(PromiseBase &&other) noexcept
         : m_ctx(other.m_ctx)
@@ -88,8 +149,8 @@ protected:
     ~PromiseBase() noexcept
     {
         if ( m_ctx ) {
-            if ( m_ctx->isFulfillable() && !m_ctx->isReady() ) {
-                setError(BrokenPromise{});
+            if ( m_ctx->isFulfillable() && !m_ctx->hasResult() ) {
+                m_ctx->setError(BrokenPromise{});
             }
             m_ctx->detachPromise();
         }
@@ -97,6 +158,156 @@ protected:
 
 protected:
     ContextType *m_ctx;
+
+private:
+    /* Errors of the set are kept in place by the context. */
+    template<typename tErrorType>
+    void setError(tErrorType &&error, std::true_type) noexcept
+    {
+        m_ctx->setTypedError(std::forward<tErrorType>(error));
+    }
+
+    template<typename tErrorType>
+    void setError(tErrorType &&error, std::false_type) noexcept
+    {
+        m_ctx->setError(std::forward<tErrorType>(error));
+    }
+
+#if SAFL_HAS_MEMORY_RESOURCE
+    static ContextType *makeContext(std::pmr::memory_resource *resource)
+    {
+        std::pmr::memory_resource *oldResource = currentMemoryResource();
+        setCurrentMemoryResource(resource);
+        auto *ctx = new InitialContext<tValueType, tErrors...>();
+        setCurrentMemoryResource(oldResource);
+        return ctx;
+    }
+#endif
+};
+
+/*******************************************************************************
+ * Timers.
+ */
+
+class Timeout {};
+
+/* The context of sleepFor(), which is fulfilled by its timer. */
+class SleepContext final
+        : public ContextBase<void>
+{
+public:
+    void start(Executor::Clock::duration duration)
+    {
+        /* The timer keeps this context alive until it runs or is cancelled. */
+        acquire(PendingTask);
+        m_timer = startTimer(m_executor, duration, [this]()
+        {
+            setValue();
+            release(PendingTask);
+        });
+    }
+
+private:
+    void acceptCancel() noexcept override
+    {
+        if ( m_timer.cancel() ) {
+            release(PendingTask);
+        }
+    }
+
+private:
+    TimerHandle m_timer;
+};
+
+/* The context of Future::within(), which passes the result of its input
+ * through, unless its timer expires first. Then it fails with Timeout and
+ * abandons the input. */
+template<typename tValue>
+class DeadlineContext final
+        : public FanInContext<tValue>
+{
+public:
+    /* The input is attached only after a future for this context exists. */
+    void attachInput(ContextNtBase *input, Executor::Clock::duration timeout)
+    {
+        DLOG(">> within");
+        this->acquire(ContextNtBase::PendingTask);
+        m_timer = startTimer(this->m_executor, timeout, [this]() { expire(); });
+        input->setTarget(this, true);
+        DLOG("<< within");
+    }
+
+    void acceptInput(ContextNtBase *ctx) noexcept override
+    {
+        if ( finish() ) {
+            acceptValue(ctx, std::is_void<tValue>{});
+        } else {
+            DLOG("input IGNORED: " << ctx->alias());
+        }
+    }
+
+    void acceptError(ContextNtBase *ctx, Signal &&error) noexcept override
+    {
+        (void)ctx;
+        if ( finish() ) {
+            this->storeError(std::move(error));
+        } else {
+            DLOG("error IGNORED: " << ctx->alias());
+        }
+    }
+
+    void acceptCancel() noexcept override
+    {
+        finish();
+        FanInContext<tValue>::acceptCancel();
+    }
+
+private:
+    /* Returns true if the input has come before the timeout. */
+    bool finish() noexcept
+    {
+        if ( m_isDone.exchange(true, std::memory_order_acq_rel) ) {
+            return false;
+        }
+        if ( m_timer.cancel() ) {
+            this->release(ContextNtBase::PendingTask);
+        }
+        return true;
+    }
+
+    void expire() noexcept
+    {
+        if ( !m_isDone.exchange(true, std::memory_order_acq_rel) ) {
+            DLOG("@@ timeout");
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            const bool isLast = this->abandonPrevs();
+            lock.unlock();
+
+            this->setError(Timeout{});
+            if ( isLast ) {
+                this->release(ContextNtBase::HasPrev);
+            }
+        }
+        this->release(ContextNtBase::PendingTask);
+    }
+
+    void acceptValue(ContextNtBase *ctx, std::false_type) noexcept
+    {
+        auto setValue = [this](auto &&value)
+        {
+            this->emplaceValue(std::forward<decltype(value)>(value));
+        };
+        passValueOf(setValue, static_cast<ContextValueBase<tValue>*>(ctx));
+    }
+
+    void acceptValue(ContextNtBase */*ctx*/, std::true_type) noexcept
+    {
+        this->setValue();
+    }
+
+private:
+    TimerHandle m_timer;
+    std::atomic<bool> m_isDone{false};
 };
 
 } // namespace detail
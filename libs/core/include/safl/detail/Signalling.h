@@ -5,10 +5,23 @@
 #pragma once
 
 // Local includes:
+#include "Allocation.h"
 #include "FunctionTraits.h"
 #include "TypeEraser.h"
 #include "UniqueInstance.h"
 
+// Std includes:
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+
 namespace safl {
 namespace detail {
 
@@ -23,19 +36,172 @@ class ContextBase;
  * @{
  */
 
+class Signal;
+
 class SignalNtBase
-        : public TypeEraser
+        : public Allocated<false>
         , private UniqueInstance
 {
-    using TypeEraser::TypeEraser;
-
 public:
     virtual ~SignalNtBase() = default;
-    virtual std::unique_ptr<SignalNtBase> clone() const noexcept = 0;
+    virtual std::type_index type() const noexcept = 0;
+
+    /* Signals in place are moved and copied with their owner. */
+    virtual SignalNtBase *moveTo(void *storage) noexcept = 0;
+    virtual SignalNtBase *copyTo(void *storage) const noexcept = 0;
+
+    /* Signals on the heap are immutable, and shared by their owners. */
+    virtual void acquire() const noexcept
+    {
+    }
+
+    virtual void release() const noexcept
+    {
+        delete this;
+    }
+};
+
+template<typename tData>
+class SignalImpl;
+
+template<typename tData>
+class SharedSignalImpl;
+
+/**
+ * @internal
+ * @brief A type-erased error or message.
+ *
+ * Small data which is copied and moved without throwing, e.g. error codes and
+ * tag types, is stored in place, so most errors and messages are not
+ * allocated. Others are allocated on the heap once, and shared by the copies
+ * which share() makes, e.g. when a message is sent to many contexts.
+ */
+class Signal
+{
+    static constexpr std::size_t c_inlineSize = 3 * sizeof(void*);
+    using Storage = std::aligned_storage_t<c_inlineSize, alignof(void*)>;
+
+    template<typename tData>
+    using IsInlined = std::integral_constant<bool,
+        sizeof(SignalImpl<tData>) <= sizeof(Storage) &&
+        alignof(SignalImpl<tData>) <= alignof(Storage) &&
+        std::is_nothrow_move_constructible<tData>::value &&
+        std::is_nothrow_copy_constructible<tData>::value>;
+
+public:
+    Signal() noexcept
+        : m_impl(nullptr)
+    {
+    }
+
+    Signal(Signal &&other) noexcept
+        : m_impl(other.take(&m_storage))
+    {
+    }
+
+    Signal &operator=(Signal &&other) noexcept
+    {
+        if ( this != &other ) {
+            reset();
+            m_impl = other.take(&m_storage);
+        }
+        return *this;
+    }
+
+    ~Signal()
+    {
+        reset();
+    }
+
+    /* Get another owner of the same data. */
+    Signal share() const noexcept
+    {
+        Signal sig;
+        if ( isInline() ) {
+            sig.m_impl = m_impl->copyTo(&sig.m_storage);
+        } else if ( m_impl != nullptr ) {
+            m_impl->acquire();
+            sig.m_impl = m_impl;
+        }
+        return sig;
+    }
+
+    template<typename tData, typename xData>
+    void emplace(xData &&data)
+    {
+        reset();
+        m_impl = make<tData>(std::forward<xData>(data));
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_impl != nullptr;
+    }
+
+    const SignalNtBase *get() const noexcept
+    {
+        return m_impl;
+    }
+
+    const SignalNtBase *operator->() const noexcept
+    {
+        return m_impl;
+    }
+
+    bool isInline() const noexcept
+    {
+        return m_impl == reinterpret_cast<const SignalNtBase*>(&m_storage);
+    }
+
+private:
+    template<typename tData, typename xData>
+    std::enable_if_t<IsInlined<tData>::value, SignalNtBase*>
+    make(xData &&data)
+    {
+        /* isInline() relies on the base class being at the same address. */
+        SignalNtBase *impl = new (&m_storage) SignalImpl<tData>(std::forward<xData>(data));
+        assert(static_cast<void*>(impl) == &m_storage);
+        return impl;
+    }
+
+    template<typename tData, typename xData>
+    std::enable_if_t<!IsInlined<tData>::value, SignalNtBase*>
+    make(xData &&data)
+    {
+        return new SharedSignalImpl<tData>(std::forward<xData>(data));
+    }
+
+    /* Give the data away, moving it to the given storage if it is in place. */
+    SignalNtBase *take(void *storage) noexcept
+    {
+        if ( !isInline() ) {
+            return std::exchange(m_impl, nullptr);
+        }
+        SignalNtBase *impl = m_impl->moveTo(storage);
+        reset();
+        return impl;
+    }
+
+    void reset() noexcept
+    {
+        if ( m_impl == nullptr ) {
+            return;
+        }
+        if ( isInline() ) {
+            m_impl->~SignalNtBase();
+        } else {
+            m_impl->release();
+        }
+        m_impl = nullptr;
+    }
+
+private:
+    SignalNtBase *m_impl;
+    Storage m_storage;
 };
 
 template<typename tData>
-class SignalImpl final
+class SignalImpl
         : public SignalNtBase
 {
     static_assert(!std::is_reference<tData>::value,
@@ -44,8 +210,7 @@ class SignalImpl final
 public:
     template<typename xData>
     explicit SignalImpl(xData &&data)
-        : SignalNtBase(typeid(xData))
-        , m_data(std::forward<xData>(data))
+        : m_data(std::forward<xData>(data))
     {
     }
 
@@ -54,27 +219,85 @@ public:
         return m_data;
     }
 
-    std::unique_ptr<SignalNtBase> clone() const noexcept override
+    std::type_index type() const noexcept override
+    {
+        return typeid(tData);
+    }
+
+    SignalNtBase *moveTo(void *storage) noexcept override
+    {
+        return new (storage) SignalImpl(std::move(m_data));
+    }
+
+    SignalNtBase *copyTo(void *storage) const noexcept override
     {
-        return std::make_unique<SignalImpl<tData>>(m_data);
+        return new (storage) SignalImpl(m_data);
     }
 
 private:
     tData m_data;
 };
 
-using Signal = std::unique_ptr<SignalNtBase>;
+template<typename tData>
+class SharedSignalImpl final
+        : public SignalImpl<tData>
+{
+public:
+    using SignalImpl<tData>::SignalImpl;
+
+    void acquire() const noexcept override
+    {
+        m_cntRefs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() const noexcept override
+    {
+        if ( m_cntRefs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+            delete this;
+        }
+    }
+
+private:
+    mutable std::atomic<unsigned int> m_cntRefs{1};
+};
 
 template<typename tData>
 Signal makeSignal(tData &&data)
 {
-    return std::make_unique<
-            SignalImpl<std::remove_reference_t<tData>>>(
-                std::forward<tData>(data));
+    Signal sig;
+    sig.emplace<std::remove_cv_t<std::remove_reference_t<tData>>>(std::forward<tData>(data));
+    return sig;
 }
 
+/* The latest message for a handler which coalesces its messages. Messages
+ * which arrive while one is pending replace it. */
+class MessageSlot
+{
+public:
+    /* Returns true if no message was pending, so it must be delivered. */
+    bool put(Signal &&msg) noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_msg = std::move(msg);
+        return !std::exchange(m_isPending, true);
+    }
+
+    Signal take() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isPending = false;
+        return std::move(m_msg);
+    }
+
+private:
+    std::mutex m_mutex;
+    Signal m_msg;
+    bool m_isPending = false;
+};
+
 class SignalHandlerNtBase
         : public TypeEraser
+        , public Allocated<false>
         , private UniqueInstance
 {
     using TypeEraser::TypeEraser;
@@ -82,6 +305,11 @@ class SignalHandlerNtBase
 public:
     virtual ~SignalHandlerNtBase() = default;
     virtual void accept(ContextNtBase *ctx, const SignalNtBase *sig) = 0;
+
+    virtual MessageSlot *messageSlot() noexcept
+    {
+        return nullptr;
+    }
 };
 
 using SignalHandler = std::unique_ptr<SignalHandlerNtBase>;
@@ -100,9 +328,10 @@ public:
     using MessageType = typename Traits::FirstArg;
 
 public:
-    explicit MessageHandler(tFunc &&f)
+    MessageHandler(tFunc &&f, bool doCoalesce)
         : SignalHandlerNtBase(typeid(MessageType))
         , m_f(std::forward<tFunc>(f))
+        , m_slot(doCoalesce ? std::make_unique<MessageSlot>() : nullptr)
     {
     }
 
@@ -111,14 +340,20 @@ public:
         m_f(static_cast<const SignalImpl<MessageType>*>(sig)->data());
     }
 
+    MessageSlot *messageSlot() noexcept override
+    {
+        return m_slot.get();
+    }
+
 private:
     std::decay_t<tFunc> m_f;
+    std::unique_ptr<MessageSlot> m_slot;
 };
 
 template<typename tFunc>
-SignalHandler makeMessageHandler(tFunc &&f)
+SignalHandler makeMessageHandler(tFunc &&f, bool doCoalesce = false)
 {
-    return std::make_unique<MessageHandler<tFunc>>(std::forward<tFunc>(f));
+    return std::make_unique<MessageHandler<tFunc>>(std::forward<tFunc>(f), doCoalesce);
 }
 
 template<typename tValueType, typename tFunc>
@@ -176,6 +411,80 @@ SignalHandler makeErrorHandler(tFunc &&f)
     return std::make_unique<ErrorHandler<tValueType, tFunc>>(std::forward<tFunc>(f));
 }
 
+/* The slot of an error of a static set, which keeps the index of its type in
+ * the set. Handlers of the set dispatch on the index at compile time, so the
+ * type of the error is never looked up at runtime. */
+template<typename... tErrors>
+class ErrorSlot
+        : private UniqueInstance
+{
+public:
+    template<std::size_t tIndex>
+    using ErrorType = std::tuple_element_t<tIndex, std::tuple<tErrors...>>;
+
+public:
+    ErrorSlot() = default;
+
+    ~ErrorSlot()
+    {
+        visit([this](auto index)
+        {
+            using Error = ErrorType<decltype(index)::value>;
+            get<decltype(index)::value>().~Error();
+        });
+    }
+
+    template<typename tError, typename tData>
+    void emplace(tData &&data)
+    {
+        assert(m_index == c_noIndex);
+        new (&m_storage) tError(std::forward<tData>(data));
+        m_index = IndexOf<tError, tErrors...>::value;
+    }
+
+    /* Move the error out of the slot of another context. */
+    void takeFrom(ErrorSlot &other)
+    {
+        other.visit([this, &other](auto index)
+        {
+            emplace<ErrorType<decltype(index)::value>>(
+                    std::move(other.template get<decltype(index)::value>()));
+        });
+    }
+
+    template<std::size_t tIndex>
+    ErrorType<tIndex> &get() noexcept
+    {
+        assert(m_index == tIndex);
+        return *reinterpret_cast<ErrorType<tIndex>*>(&m_storage);
+    }
+
+    /* Call the given callable with the index of the error as an integral
+     * constant. The index is matched by a fold of comparisons, which the
+     * compiler turns into a switch. */
+    template<typename tFunc>
+    void visit(tFunc &&f)
+    {
+        visit(f, std::index_sequence_for<tErrors...>{});
+    }
+
+private:
+    template<typename tFunc, std::size_t... tIndices>
+    void visit(tFunc &f, std::index_sequence<tIndices...>)
+    {
+        (void)std::initializer_list<int>{
+            (m_index == tIndices ? (f(std::integral_constant<std::size_t, tIndices>{}), 0)
+                                 : 0)...
+        };
+    }
+
+private:
+    static constexpr std::size_t c_noIndex = sizeof...(tErrors);
+
+    std::aligned_union_t<1, tErrors...> m_storage;
+    std::size_t m_index = c_noIndex;
+};
+
 /// @}
 
 } // namespace detail
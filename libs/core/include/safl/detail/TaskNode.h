@@ -0,0 +1,99 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Std includes:
+#include <atomic>
+#include <cstddef>
+
+namespace safl {
+namespace detail {
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief The base class for objects which are queued by executors intrusively.
+ *
+ * A node carries its own queue link, so scheduling it does not allocate.
+ * A node may be queued by one executor at a time only. run() may destroy
+ * the node.
+ */
+class TaskNode
+{
+public:
+    virtual void run() noexcept = 0;
+
+    /* The link is atomic for lock-free queues, other queues may access it
+     * with a relaxed order. */
+    TaskNode *nextNode(std::memory_order order = std::memory_order_relaxed) const noexcept
+    {
+        return m_nextNode.load(order);
+    }
+
+    void setNextNode(TaskNode *node,
+                     std::memory_order order = std::memory_order_relaxed) noexcept
+    {
+        m_nextNode.store(node, order);
+    }
+
+protected:
+    TaskNode() = default;
+    ~TaskNode() = default;
+
+private:
+    std::atomic<TaskNode*> m_nextNode{nullptr};
+};
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief A non-thread-safe intrusive FIFO queue of nodes.
+ */
+class TaskQueue
+{
+public:
+    bool isEmpty() const noexcept
+    {
+        return m_head == nullptr;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    void push(TaskNode *node) noexcept
+    {
+        node->setNextNode(nullptr);
+        if ( m_tail == nullptr ) {
+            m_head = node;
+        } else {
+            m_tail->setNextNode(node);
+        }
+        m_tail = node;
+        m_size++;
+    }
+
+    TaskNode *pop() noexcept
+    {
+        TaskNode *node = m_head;
+        if ( node != nullptr ) {
+            m_head = node->nextNode();
+            if ( m_head == nullptr ) {
+                m_tail = nullptr;
+            }
+            m_size--;
+        }
+        return node;
+    }
+
+private:
+    TaskNode *m_head = nullptr;
+    TaskNode *m_tail = nullptr;
+    std::size_t m_size = 0;
+};
+
+} // namespace detail
+} // namespace safl
@@ -0,0 +1,218 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+// Local includes:
+#include "../Executor.h"
+
+// Std includes:
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace safl {
+namespace detail {
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief A timer, which runs a task in its executor when it expires.
+ *
+ * The timer is shared by the timer queue of the executor and its owner, each
+ * of which releases it once. The queue expires the timer when it is due, and
+ * the task runs unless the owner has cancelled the timer before. Cancelled
+ * timers stay in the queue until they are due or the queue drops them.
+ */
+class TimerNode final
+        : public TaskNode
+        , public Allocated<false>
+{
+public:
+    using Clock = Executor::Clock;
+
+public:
+    TimerNode(Executor *executor, Clock::time_point deadline, Task &&task) noexcept;
+
+    Clock::time_point deadline() const noexcept
+    {
+        return m_deadline;
+    }
+
+    Executor *executor() const noexcept
+    {
+        return m_executor;
+    }
+
+    bool isCancelled() const noexcept;
+
+    /* The sequence number orders timers with the same deadline. */
+    void setSequence(std::uint64_t sequence) noexcept
+    {
+        m_sequence = sequence;
+    }
+
+    bool isBefore(const TimerNode *other) const noexcept
+    {
+        return m_deadline < other->m_deadline ||
+               (m_deadline == other->m_deadline && m_sequence < other->m_sequence);
+    }
+
+    /* Used by the owner. cancel() returns false if the task runs anyway. */
+    bool cancel() noexcept;
+    void release() noexcept;
+
+    /* Used by the queue. */
+    void expire() noexcept;
+    void discard() noexcept;
+
+private:
+    void run() noexcept override;
+
+private:
+    enum State : unsigned int
+    {
+        Armed,
+        Fired,
+        Cancelled
+    };
+
+    Executor *m_executor;
+    const Clock::time_point m_deadline;
+    std::uint64_t m_sequence = 0;
+    Task m_task;
+    std::atomic<unsigned int> m_state{Armed};
+    std::atomic<unsigned int> m_cntRefs{2};
+};
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief The reference of the owner of a timer.
+ */
+class TimerHandle
+{
+public:
+    TimerHandle() noexcept
+        : m_timer(nullptr)
+    {
+    }
+
+    explicit TimerHandle(TimerNode *timer) noexcept
+        : m_timer(timer)
+    {
+    }
+
+    TimerHandle(TimerHandle &&other) noexcept
+        : m_timer(other.m_timer)
+    {
+        other.m_timer = nullptr;
+    }
+
+    TimerHandle &operator=(TimerHandle &&other) noexcept
+    {
+        if ( this != &other ) {
+            reset();
+            m_timer = other.m_timer;
+            other.m_timer = nullptr;
+        }
+        return *this;
+    }
+
+    ~TimerHandle()
+    {
+        reset();
+    }
+
+    /* Returns true if the task of the timer will not run. */
+    bool cancel() noexcept
+    {
+        return m_timer != nullptr && m_timer->cancel();
+    }
+
+private:
+    void reset() noexcept
+    {
+        if ( m_timer != nullptr ) {
+            m_timer->release();
+            m_timer = nullptr;
+        }
+    }
+
+private:
+    TimerNode *m_timer;
+};
+
+/**
+ * @internal
+ * @ingroup Exec
+ * @brief A non-thread-safe queue of timers, ordered by their deadlines.
+ *
+ * The queue is a binary heap, so a timer is added in O(log n). A timer is
+ * cancelled by its owner in O(1), and the queue drops cancelled timers when
+ * they reach the top, or all at once when the heap has doubled since the
+ * last time, which keeps the heap proportional to the live timers.
+ */
+class TimerQueue
+{
+public:
+    using Clock = Executor::Clock;
+
+public:
+    TimerQueue() = default;
+    TimerQueue(const TimerQueue &) = delete;
+    TimerQueue &operator=(const TimerQueue &) = delete;
+    ~TimerQueue();
+
+    bool isEmpty() noexcept;
+
+    /* The deadline of the first timer, which must exist. */
+    Clock::time_point nextDeadline() noexcept;
+
+    /* Returns true if the timer is the first one now. */
+    bool push(TimerNode *timer);
+
+    /* Take the first timer if it is due by the given time. */
+    TimerNode *popDue(Clock::time_point now) noexcept;
+
+    /* Drop all timers, without running them. */
+    void clear() noexcept;
+
+    /* Drop the timers of the executor, without running them. */
+    void discardOf(const Executor *executor) noexcept;
+
+private:
+    void dropCancelled() noexcept;
+    void compact() noexcept;
+    TimerNode *pop() noexcept;
+
+private:
+    std::vector<TimerNode*> m_heap;
+    std::size_t m_compactSize = 64;
+    std::uint64_t m_sequence = 0;
+};
+
+/**
+ * @internal
+ * @brief Start a timer which runs the task in the executor after the delay.
+ */
+TimerHandle startTimer(Executor *executor, Executor::Clock::duration delay, Task &&task);
+
+/**
+ * @internal
+ * @brief Add a timer to the timer thread shared by executors which have no
+ * timers of their own.
+ */
+void startSharedTimer(TimerNode *timer);
+
+/**
+ * @internal
+ * @brief Drop the shared timers of an executor which is being destroyed.
+ *
+ * When this returns, the timer thread does not touch the executor anymore.
+ */
+void dropSharedTimers(const Executor *executor) noexcept;
+
+} // namespace detail
+} // namespace safl
@@ -0,0 +1,323 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/ContextPool.h>
+
+// Local includes:
+#include <safl/detail/Allocation.h>
+
+// Std includes:
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+using namespace safl;
+
+namespace {
+
+constexpr std::size_t c_granularity = 32;
+constexpr std::size_t c_cntClasses = 16;
+constexpr std::size_t c_maxObjectSize = c_granularity * c_cntClasses;
+
+/* Chunks are aligned to their size, so the chunk of a block is found by
+ * masking its address. */
+constexpr std::size_t c_chunkSize = 64 * 1024;
+
+std::size_t classIndex(std::size_t size) noexcept
+{
+    assert(size > 0 && size <= c_maxObjectSize);
+    return (size + c_granularity - 1) / c_granularity - 1;
+}
+
+std::size_t classSize(std::size_t index) noexcept
+{
+    return (index + 1) * c_granularity;
+}
+
+/* Counters are written by the owning thread only, but may be read by any. */
+void increase(std::atomic<std::size_t> &counter, std::size_t value = 1) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+void decrease(std::atomic<std::size_t> &counter) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) - 1,
+                  std::memory_order_relaxed);
+}
+
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+class Heap;
+
+struct Chunk
+{
+    Heap *heap;
+    std::size_t classIndex;
+};
+
+/* The blocks start after the header, so they are aligned as the granularity. */
+constexpr std::size_t c_chunkHeaderSize =
+        (sizeof(Chunk) + c_granularity - 1) / c_granularity * c_granularity;
+
+Chunk *chunkOf(void *ptr) noexcept
+{
+    return reinterpret_cast<Chunk*>(
+            reinterpret_cast<std::uintptr_t>(ptr) & ~(c_chunkSize - 1));
+}
+
+/* The slabs of a thread. */
+class Heap
+{
+public:
+    void *allocate(std::size_t index)
+    {
+        SizeClass &sizeClass = m_classes[index];
+        if ( sizeClass.freeList == nullptr ) {
+            collectRemote();
+            if ( sizeClass.freeList == nullptr ) {
+                addChunk(index);
+            }
+        }
+
+        FreeBlock *block = sizeClass.freeList;
+        sizeClass.freeList = block->next;
+        sizeClass.cntFree--;
+        increase(sizeClass.cntLive);
+        return block;
+    }
+
+    void free(void *ptr, std::size_t index) noexcept
+    {
+        SizeClass &sizeClass = m_classes[index];
+        sizeClass.freeList = new (ptr) FreeBlock{sizeClass.freeList};
+        sizeClass.cntFree++;
+        decrease(sizeClass.cntLive);
+    }
+
+    /* This may be called by any thread. */
+    void freeRemote(void *ptr) noexcept
+    {
+        auto *block = new (ptr) FreeBlock{m_remoteFrees.load(std::memory_order_relaxed)};
+        while ( !m_remoteFrees.compare_exchange_weak(block->next, block,
+                                                     std::memory_order_release,
+                                                     std::memory_order_relaxed) ) {
+        }
+    }
+
+    /* The list is taken as a whole, so it is not prone to ABA. */
+    void collectRemote() noexcept
+    {
+        FreeBlock *block = m_remoteFrees.exchange(nullptr, std::memory_order_acquire);
+        while ( block != nullptr ) {
+            FreeBlock *next = block->next;
+            free(block, chunkOf(block)->classIndex);
+            block = next;
+        }
+    }
+
+    void reserve(std::size_t index, std::size_t cnt)
+    {
+        collectRemote();
+        while ( m_classes[index].cntFree < cnt ) {
+            addChunk(index);
+        }
+    }
+
+    void addStats(std::vector<ContextPool::Stats> &stats) const noexcept
+    {
+        for ( std::size_t i = 0; i < c_cntClasses; i++ ) {
+            stats[i].cntLive += m_classes[i].cntLive.load(std::memory_order_relaxed);
+            stats[i].bytesReserved +=
+                    m_classes[i].bytesReserved.load(std::memory_order_relaxed);
+        }
+    }
+
+public:
+    Heap *nextAbandoned = nullptr;
+
+private:
+    struct SizeClass
+    {
+        FreeBlock *freeList = nullptr;
+        std::size_t cntFree = 0;
+        std::atomic<std::size_t> cntLive{0};
+        std::atomic<std::size_t> bytesReserved{0};
+    };
+
+    void addChunk(std::size_t index)
+    {
+        void *memory = allocateChunk();
+        new (memory) Chunk{this, index};
+
+        /* Blocks are pushed in reverse, so they are allocated in the order of
+         * addresses. */
+        const std::size_t size = classSize(index);
+        const std::size_t cntBlocks = (c_chunkSize - c_chunkHeaderSize) / size;
+        char *first = static_cast<char*>(memory) + c_chunkHeaderSize;
+        SizeClass &sizeClass = m_classes[index];
+        for ( std::size_t i = cntBlocks; i > 0; i-- ) {
+            sizeClass.freeList = new (first + (i - 1) * size) FreeBlock{sizeClass.freeList};
+        }
+        sizeClass.cntFree += cntBlocks;
+        increase(sizeClass.bytesReserved, c_chunkSize);
+    }
+
+    /* Chunks are never released, as the heap is never destroyed. */
+    static void *allocateChunk()
+    {
+#ifdef __cpp_aligned_new
+        return ::operator new(c_chunkSize, std::align_val_t{c_chunkSize});
+#else
+        /* Without aligned new, the chunk is cut out of an allocation twice its
+         * size. */
+        const auto address = reinterpret_cast<std::uintptr_t>(::operator new(2 * c_chunkSize));
+        return reinterpret_cast<void*>((address + c_chunkSize - 1) & ~(c_chunkSize - 1));
+#endif
+    }
+
+private:
+    std::array<SizeClass, c_cntClasses> m_classes;
+    std::atomic<FreeBlock*> m_remoteFrees{nullptr};
+};
+
+/* Heaps are never destroyed, as their blocks may be freed at any time. */
+class Registry
+{
+public:
+    Heap *acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Heap *heap = m_abandoned;
+        if ( heap != nullptr ) {
+            m_abandoned = heap->nextAbandoned;
+            heap->nextAbandoned = nullptr;
+        } else {
+            heap = new Heap();
+            m_heaps.push_back(heap);
+        }
+        return heap;
+    }
+
+    void abandon(Heap *heap)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        heap->nextAbandoned = m_abandoned;
+        m_abandoned = heap;
+    }
+
+    std::vector<ContextPool::Stats> stats()
+    {
+        std::vector<ContextPool::Stats> stats(c_cntClasses);
+        for ( std::size_t i = 0; i < c_cntClasses; i++ ) {
+            stats[i].objectSize = classSize(i) - detail::c_allocationHeaderSize;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for ( const Heap *heap : m_heaps ) {
+            heap->addStats(stats);
+        }
+        return stats;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<Heap*> m_heaps;
+    Heap *m_abandoned = nullptr;
+};
+
+Registry &registry()
+{
+    /* The registry outlives all other static objects, which may free contexts
+     * when they are destroyed. */
+    static Registry *s_registry = new Registry();
+    return *s_registry;
+}
+
+thread_local Heap *t_heap = nullptr;
+thread_local bool t_isExiting = false;
+
+/* Abandons the heap of a thread when it exits. */
+class HeapOwner
+{
+public:
+    ~HeapOwner()
+    {
+        t_isExiting = true;
+        t_heap = nullptr;
+        if ( m_heap != nullptr ) {
+            registry().abandon(m_heap);
+        }
+    }
+
+    void own(Heap *heap) noexcept
+    {
+        m_heap = heap;
+    }
+
+private:
+    Heap *m_heap = nullptr;
+};
+
+thread_local HeapOwner t_owner;
+
+Heap &currentHeap()
+{
+    if ( t_heap == nullptr ) {
+        t_heap = registry().acquire();
+        t_heap->collectRemote();
+
+        /* A heap acquired while the thread exits is never reused. */
+        if ( !t_isExiting ) {
+            t_owner.own(t_heap);
+        }
+    }
+    return *t_heap;
+}
+
+} // anonymous namespace
+
+void ContextPool::reserve(std::size_t objectSize, std::size_t cnt)
+{
+    objectSize += detail::c_allocationHeaderSize;
+    if ( objectSize <= c_maxObjectSize ) {
+        currentHeap().reserve(classIndex(objectSize), cnt);
+    }
+}
+
+std::vector<ContextPool::Stats> ContextPool::stats()
+{
+    return registry().stats();
+}
+
+void *ContextPool::allocate(std::size_t size)
+{
+    if ( size > c_maxObjectSize ) {
+        return ::operator new(size);
+    }
+    return currentHeap().allocate(classIndex(size));
+}
+
+void ContextPool::deallocate(void *ptr, std::size_t size) noexcept
+{
+    if ( size > c_maxObjectSize ) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    Chunk *chunk = chunkOf(ptr);
+    if ( chunk->heap == t_heap ) {
+        chunk->heap->free(ptr, chunk->classIndex);
+    } else {
+        chunk->heap->freeRemote(ptr);
+    }
+}
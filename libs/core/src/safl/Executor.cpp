@@ -5,16 +5,133 @@
 // Self-include:
 #include <safl/Executor.h>
 
+// Local includes:
+#include <safl/detail/Timer.h>
+
+// Std includes:
+#include <atomic>
+
 using namespace safl;
 
-static Executor *s_executor;
+static std::atomic<Executor*> s_executor{nullptr};
+static thread_local Executor *t_executor = nullptr;
+static thread_local BatchScope *t_batchScope = nullptr;
+
+static std::atomic<ContinuationPolicy> s_policy{ContinuationPolicy::Post};
+/* Each nested continuation takes several call frames, so the depth bounds the
+ * stack growth of a chain. Compare the inlineChain and postedChain benchmarks
+ * before changing the default. */
+static std::atomic<std::size_t> s_maxInlineDepth{4};
+
+Executor::~Executor() noexcept
+{
+    detail::dropSharedTimers(this);
+}
+
+void Executor::startTimer(detail::TimerNode *timer) noexcept
+{
+    detail::startSharedTimer(timer);
+}
+
+void Executor::setContinuationPolicy(ContinuationPolicy policy) noexcept
+{
+    m_policy.store(policy, std::memory_order_relaxed);
+}
+
+ContinuationPolicy Executor::continuationPolicy() const noexcept
+{
+    const ContinuationPolicy policy = m_policy.load(std::memory_order_relaxed);
+    if ( policy != ContinuationPolicy::Default ) {
+        return policy;
+    }
+    return s_policy.load(std::memory_order_relaxed);
+}
+
+void Executor::setDefaultContinuationPolicy(ContinuationPolicy policy) noexcept
+{
+    assert(policy != ContinuationPolicy::Default);
+    s_policy.store(policy, std::memory_order_relaxed);
+}
+
+void Executor::setMaxInlineDepth(std::size_t depth) noexcept
+{
+    s_maxInlineDepth.store(depth, std::memory_order_relaxed);
+}
+
+std::size_t Executor::maxInlineDepth() noexcept
+{
+    return s_maxInlineDepth.load(std::memory_order_relaxed);
+}
 
 void Executor::setInstance(Executor *executor) noexcept
 {
-    s_executor = executor;
+    s_executor.store(executor, std::memory_order_release);
+}
+
+void Executor::setThreadInstance(Executor *executor) noexcept
+{
+    t_executor = executor;
+}
+
+Executor *Executor::threadInstance() noexcept
+{
+    return t_executor;
 }
 
 Executor *Executor::instance() noexcept
 {
-    return s_executor;
+    if ( t_executor != nullptr ) {
+        return t_executor;
+    }
+    return s_executor.load(std::memory_order_acquire);
+}
+
+BatchScope::BatchScope() noexcept
+    : m_outer(t_batchScope)
+{
+    if ( m_outer == nullptr ) {
+        t_batchScope = this;
+    }
+}
+
+BatchScope::~BatchScope()
+{
+    if ( m_outer == nullptr ) {
+        /* The scope is closed first, so nodes which an executor runs right
+         * away are not deferred again. */
+        t_batchScope = nullptr;
+        flush();
+    }
+}
+
+bool BatchScope::defer(Executor *executor, detail::TaskNode *node) noexcept
+{
+    BatchScope *scope = t_batchScope;
+    if ( scope == nullptr ) {
+        return false;
+    }
+
+    for ( std::size_t i = 0; i < scope->m_cntBatches; i++ ) {
+        Batch &batch = scope->m_batches[i];
+        if ( batch.executor == executor ) {
+            batch.nodes.push(node);
+            return true;
+        }
+    }
+
+    if ( scope->m_cntBatches == c_maxBatches ) {
+        return false;
+    }
+    Batch &batch = scope->m_batches[scope->m_cntBatches++];
+    batch.executor = executor;
+    batch.nodes.push(node);
+    return true;
+}
+
+void BatchScope::flush() noexcept
+{
+    for ( std::size_t i = 0; i < m_cntBatches; i++ ) {
+        m_batches[i].executor->scheduleBatch(m_batches[i].nodes);
+    }
+    m_cntBatches = 0;
 }
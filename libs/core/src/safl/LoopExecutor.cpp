@@ -0,0 +1,218 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/LoopExecutor.h>
+
+// Local includes:
+#include <safl/detail/Timer.h>
+
+// Std includes:
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+// System includes:
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace safl;
+
+namespace {
+
+/* The maximum number of tasks run by a single poll(). */
+constexpr std::size_t c_maxPollBatch = 256;
+
+/* The loop the current thread is running, if any. */
+thread_local const LoopExecutor *t_loop = nullptr;
+
+/* While the loop runs, it is the executor of the thread, so contexts created
+ * by its tasks stay in the loop. */
+class LoopGuard
+{
+public:
+    explicit LoopGuard(LoopExecutor *loop) noexcept
+        : m_prevLoop(t_loop)
+        , m_prevExecutor(Executor::threadInstance())
+    {
+        t_loop = loop;
+        Executor::setThreadInstance(loop);
+    }
+
+    ~LoopGuard()
+    {
+        t_loop = m_prevLoop;
+        Executor::setThreadInstance(m_prevExecutor);
+    }
+
+private:
+    const LoopExecutor *m_prevLoop;
+    Executor *m_prevExecutor;
+};
+
+} // anonymous namespace
+
+LoopExecutor::LoopExecutor()
+    : m_isSignalled(false)
+    , m_isStopped(false)
+    , m_threadId(std::this_thread::get_id())
+    , m_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if ( m_fd < 0 ) {
+        throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+}
+
+LoopExecutor::~LoopExecutor() noexcept
+{
+    detail::dropSharedTimers(this);
+    assert(m_queue.isEmpty());
+    close(m_fd);
+}
+
+void LoopExecutor::invoke(Task &&task) noexcept
+{
+    schedule(new detail::TaskBox(std::move(task)));
+}
+
+void LoopExecutor::schedule(TaskNode *node) noexcept
+{
+    m_queue.push(node);
+    signal();
+}
+
+bool LoopExecutor::isInExecutorThread() const noexcept
+{
+    /* Before the loop is run for the first time, the executor thread is
+     * the one which has created the executor. */
+    return t_loop == this ||
+           m_threadId.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
+
+std::size_t LoopExecutor::run() noexcept
+{
+    LoopGuard guard(this);
+    enterLoop();
+
+    std::size_t cnt = 0;
+    while ( !m_isStopped.exchange(false, std::memory_order_acq_rel) ) {
+        if ( runNext() ) {
+            cnt++;
+        } else {
+            wait();
+        }
+    }
+    return cnt;
+}
+
+std::size_t LoopExecutor::runOne() noexcept
+{
+    LoopGuard guard(this);
+    enterLoop();
+
+    while ( !m_isStopped.exchange(false, std::memory_order_acq_rel) ) {
+        if ( runNext() ) {
+            return 1;
+        }
+        wait();
+    }
+    return 0;
+}
+
+std::size_t LoopExecutor::poll() noexcept
+{
+    LoopGuard guard(this);
+    enterLoop();
+
+    /* Consume the wake-up first, so tasks queued meanwhile make fd() readable
+     * again. */
+    m_isSignalled.store(false, std::memory_order_seq_cst);
+    std::uint64_t value;
+    while ( read(m_fd, &value, sizeof(value)) > 0 ) {
+    }
+
+    std::size_t cnt = 0;
+    while ( cnt < c_maxPollBatch && runNext() ) {
+        cnt++;
+    }
+
+    if ( !m_queue.isEmpty() ) {
+        signal();
+    }
+    return cnt;
+}
+
+std::size_t LoopExecutor::runUntilIdle() noexcept
+{
+    LoopGuard guard(this);
+    enterLoop();
+
+    std::size_t cnt = 0;
+    while ( !m_queue.isEmpty() ) {
+        if ( runNext() ) {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+void LoopExecutor::stop() noexcept
+{
+    m_isStopped.store(true, std::memory_order_release);
+    m_isSignalled.store(true, std::memory_order_seq_cst);
+    const std::uint64_t one = 1;
+    (void)write(m_fd, &one, sizeof(one));
+}
+
+int LoopExecutor::fd() const noexcept
+{
+    return m_fd;
+}
+
+bool LoopExecutor::runNext() noexcept
+{
+    TaskNode *node = m_queue.pop();
+    if ( node == nullptr ) {
+        return false;
+    }
+    node->run();
+    return true;
+}
+
+void LoopExecutor::signal() noexcept
+{
+    /* Only the first producer after the consumer has gone to sleep makes
+     * a system call. */
+    if ( !m_isSignalled.load(std::memory_order_seq_cst) &&
+         !m_isSignalled.exchange(true, std::memory_order_seq_cst) ) {
+        const std::uint64_t one = 1;
+        (void)write(m_fd, &one, sizeof(one));
+    }
+}
+
+void LoopExecutor::wait() noexcept
+{
+    m_isSignalled.store(false, std::memory_order_seq_cst);
+
+    /* Tasks queued before the flag was cleared did not signal. A producer
+     * which is in the middle of pushing makes the queue non-empty as well. */
+    if ( !m_queue.isEmpty() || m_isStopped.load(std::memory_order_acquire) ) {
+        return;
+    }
+
+    pollfd pfd{m_fd, POLLIN, 0};
+    while ( ::poll(&pfd, 1, -1) < 0 ) {
+    }
+
+    std::uint64_t value;
+    while ( read(m_fd, &value, sizeof(value)) > 0 ) {
+    }
+}
+
+void LoopExecutor::enterLoop() noexcept
+{
+    m_threadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
@@ -0,0 +1,490 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/ThreadPoolExecutor.h>
+
+// Local includes:
+#include <safl/detail/Timer.h>
+
+// Std includes:
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#ifdef SAFL_HAS_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#endif
+
+using namespace safl;
+
+namespace {
+
+using safl::detail::Task;
+using safl::detail::TaskBox;
+using safl::detail::TaskNode;
+
+constexpr std::size_t c_initialDequeCapacity = 256;
+
+/* A dynamically growing work-stealing deque by Chase and Lev, in the C11
+ * formulation by Le et al. The owner pushes and pops items at the bottom,
+ * thieves steal them from the top. Buffers which were replaced by a bigger one
+ * are kept until the deque is destroyed, because thieves may still read them. */
+template<typename tItem>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable<tItem>::value,
+                  "items must be trivially copyable");
+
+    class Buffer
+    {
+    public:
+        explicit Buffer(std::size_t capacity)
+            : m_mask(capacity - 1)
+            , m_items(new std::atomic<tItem>[capacity])
+        {
+        }
+
+        std::int64_t capacity() const noexcept
+        {
+            return static_cast<std::int64_t>(m_mask + 1);
+        }
+
+        tItem get(std::int64_t idx) const noexcept
+        {
+            return m_items[static_cast<std::size_t>(idx) & m_mask]
+                    .load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t idx, tItem item) noexcept
+        {
+            m_items[static_cast<std::size_t>(idx) & m_mask]
+                    .store(item, std::memory_order_relaxed);
+        }
+
+    private:
+        const std::size_t m_mask;
+        std::unique_ptr<std::atomic<tItem>[]> m_items;
+    };
+
+public:
+    WorkStealingDeque()
+        : m_top(0)
+        , m_bottom(0)
+    {
+        m_buffers.push_back(std::make_unique<Buffer>(c_initialDequeCapacity));
+        m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(tItem item)
+    {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_top.load(std::memory_order_acquire);
+        Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+        if ( bottom - top >= buffer->capacity() ) {
+            buffer = grow(buffer, top, bottom);
+        }
+        buffer->put(bottom, item);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    bool pop(tItem &item)
+    {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+        std::int64_t top = m_top.load(std::memory_order_seq_cst);
+
+        if ( top > bottom ) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = buffer->get(bottom);
+        if ( top == bottom ) {
+            /* This is the last item, so thieves might be after it as well. */
+            const bool isTaken = m_top.compare_exchange_strong(
+                        top, top + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return isTaken;
+        }
+        return true;
+    }
+
+    bool steal(tItem &item)
+    {
+        std::int64_t top = m_top.load(std::memory_order_seq_cst);
+        const std::int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+        if ( top >= bottom ) {
+            return false;
+        }
+
+        item = m_buffer.load(std::memory_order_acquire)->get(top);
+        return m_top.compare_exchange_strong(
+                    top, top + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return m_bottom.load(std::memory_order_seq_cst) <=
+               m_top.load(std::memory_order_seq_cst);
+    }
+
+private:
+    Buffer *grow(Buffer *buffer, std::int64_t top, std::int64_t bottom)
+    {
+        auto bigger = std::make_unique<Buffer>(
+                    2 * static_cast<std::size_t>(buffer->capacity()));
+        for ( auto idx = top; idx < bottom; idx++ ) {
+            bigger->put(idx, buffer->get(idx));
+        }
+        m_buffers.push_back(std::move(bigger));
+        m_buffer.store(m_buffers.back().get(), std::memory_order_release);
+        return m_buffers.back().get();
+    }
+
+private:
+    std::atomic<std::int64_t> m_top;
+    std::atomic<std::int64_t> m_bottom;
+    std::atomic<Buffer*> m_buffer;
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+};
+
+/* An event count. A thread which runs out of work announces that it is going
+ * to wait, checks for work once again and only then waits. A producer wakes
+ * waiters up only if there are any, so a busy pool does not make system calls. */
+class Parking
+{
+public:
+    std::uint32_t prepareWait() noexcept
+    {
+        m_cntWaiters.fetch_add(1, std::memory_order_seq_cst);
+        return m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancelWait() noexcept
+    {
+        m_cntWaiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wait(std::uint32_t epoch) noexcept
+    {
+#ifdef SAFL_HAS_FUTEX
+        while ( m_epoch.load(std::memory_order_seq_cst) == epoch ) {
+            syscall(SYS_futex, futexWord(), FUTEX_WAIT_PRIVATE, epoch,
+                    nullptr, nullptr, 0);
+        }
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&]()
+        {
+            return m_epoch.load(std::memory_order_seq_cst) != epoch;
+        });
+#endif
+        cancelWait();
+    }
+
+    void notifyOne() noexcept
+    {
+        notify(1);
+    }
+
+    void notifyAll() noexcept
+    {
+        notify(INT32_MAX);
+    }
+
+private:
+    void notify(int cnt) noexcept
+    {
+        /* This is a read-modify-write rather than a load, so either a waiter
+         * announcing itself sees the new work, or this sees the waiter. */
+        if ( m_cntWaiters.fetch_add(0, std::memory_order_seq_cst) == 0 ) {
+            return;
+        }
+
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+#ifdef SAFL_HAS_FUTEX
+        syscall(SYS_futex, futexWord(), FUTEX_WAKE_PRIVATE, cnt,
+                nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        if ( cnt == 1 ) {
+            m_cv.notify_one();
+        } else {
+            m_cv.notify_all();
+        }
+#endif
+    }
+
+#ifdef SAFL_HAS_FUTEX
+    std::uint32_t *futexWord() noexcept
+    {
+        static_assert(sizeof(m_epoch) == sizeof(std::uint32_t),
+                      "futex requires a plain 32-bit word");
+        return reinterpret_cast<std::uint32_t*>(&m_epoch);
+    }
+#endif
+
+private:
+    std::atomic<std::uint32_t> m_epoch{0};
+    std::atomic<std::uint32_t> m_cntWaiters{0};
+#ifndef SAFL_HAS_FUTEX
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+#endif
+};
+
+} // anonymous namespace
+
+class ThreadPoolExecutor::Pool
+{
+public:
+    Pool(Executor *executor, std::size_t cntWorkers);
+    ~Pool() noexcept;
+
+    void invoke(Task &&task) noexcept;
+    void schedule(TaskNode *node) noexcept;
+    bool isWorkerThread() const noexcept;
+    std::size_t size() const noexcept;
+
+private:
+    struct Worker
+    {
+        WorkStealingDeque<TaskNode*> deque;
+        std::atomic<TaskNode*> lifoSlot{nullptr};
+        std::uint32_t seed;
+        std::thread thread;
+    };
+
+    void run(Worker &worker) noexcept;
+    TaskNode *findTask(Worker &worker) noexcept;
+    TaskNode *takeInjected() noexcept;
+    TaskNode *steal(Worker &thief) noexcept;
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_injectedMutex;
+    detail::TaskQueue m_injected;
+    std::atomic<std::size_t> m_cntInjected{0};
+    Parking m_parking;
+    std::atomic<bool> m_isStopping{false};
+};
+
+namespace {
+
+/* The pool and the worker the current thread belongs to, if any. */
+thread_local const void *t_pool = nullptr;
+thread_local void *t_worker = nullptr;
+
+} // anonymous namespace
+
+ThreadPoolExecutor::Pool::Pool(Executor *executor, std::size_t cntWorkers)
+{
+    cntWorkers = std::max<std::size_t>(cntWorkers, 1);
+    for ( std::size_t i = 0; i < cntWorkers; i++ ) {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->seed = static_cast<std::uint32_t>(i + 1) * 2654435761u;
+    }
+
+    /* Workers are started only when all of them exist, as they steal from
+     * each other. */
+    for ( auto &worker : m_workers ) {
+        Worker *w = worker.get();
+        w->thread = std::thread([this, w, executor]()
+        {
+            /* Contexts created by tasks, e.g. continuations of continuations,
+             * stay in the pool. */
+            Executor::setThreadInstance(executor);
+            t_pool = this;
+            t_worker = w;
+            run(*w);
+        });
+    }
+}
+
+ThreadPoolExecutor::Pool::~Pool() noexcept
+{
+    m_isStopping.store(true, std::memory_order_seq_cst);
+    m_parking.notifyAll();
+    for ( auto &worker : m_workers ) {
+        worker->thread.join();
+    }
+    assert(m_injected.isEmpty());
+}
+
+void ThreadPoolExecutor::Pool::invoke(Task &&task) noexcept
+{
+    schedule(new TaskBox(std::move(task)));
+}
+
+void ThreadPoolExecutor::Pool::schedule(TaskNode *node) noexcept
+{
+    if ( t_pool == this ) {
+        /* The newest task goes to the LIFO slot and is executed next by this
+         * worker. The task it replaces is pushed to the deque. */
+        auto *worker = static_cast<Worker*>(t_worker);
+        TaskNode *replaced = worker->lifoSlot.exchange(node, std::memory_order_acq_rel);
+        if ( replaced == nullptr ) {
+            return;
+        }
+        worker->deque.push(replaced);
+    } else {
+        std::lock_guard<std::mutex> lock(m_injectedMutex);
+        m_injected.push(node);
+        m_cntInjected.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    m_parking.notifyOne();
+}
+
+bool ThreadPoolExecutor::Pool::isWorkerThread() const noexcept
+{
+    return t_pool == this;
+}
+
+std::size_t ThreadPoolExecutor::Pool::size() const noexcept
+{
+    return m_workers.size();
+}
+
+void ThreadPoolExecutor::Pool::run(Worker &worker) noexcept
+{
+    for ( ;; ) {
+        TaskNode *task = findTask(worker);
+
+        if ( task == nullptr ) {
+            const auto epoch = m_parking.prepareWait();
+            task = findTask(worker);
+            if ( task == nullptr ) {
+                if ( m_isStopping.load(std::memory_order_seq_cst) ) {
+                    m_parking.cancelWait();
+                    break;
+                }
+                m_parking.wait(epoch);
+                continue;
+            }
+            m_parking.cancelWait();
+        }
+
+        task->run();
+    }
+}
+
+TaskNode *ThreadPoolExecutor::Pool::findTask(Worker &worker) noexcept
+{
+    TaskNode *task = worker.lifoSlot.exchange(nullptr, std::memory_order_acq_rel);
+    if ( task != nullptr ) {
+        return task;
+    }
+
+    if ( worker.deque.pop(task) ) {
+        return task;
+    }
+
+    task = takeInjected();
+    if ( task != nullptr ) {
+        return task;
+    }
+
+    return steal(worker);
+}
+
+TaskNode *ThreadPoolExecutor::Pool::takeInjected() noexcept
+{
+    if ( m_cntInjected.load(std::memory_order_seq_cst) == 0 ) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_injectedMutex);
+    TaskNode *task = m_injected.pop();
+    if ( task == nullptr ) {
+        return nullptr;
+    }
+    m_cntInjected.fetch_sub(1, std::memory_order_seq_cst);
+    return task;
+}
+
+TaskNode *ThreadPoolExecutor::Pool::steal(Worker &thief) noexcept
+{
+    /* Start at a random victim, so thieves do not crowd at the same worker. */
+    thief.seed ^= thief.seed << 13;
+    thief.seed ^= thief.seed >> 17;
+    thief.seed ^= thief.seed << 5;
+
+    const std::size_t cntWorkers = m_workers.size();
+    const std::size_t first = thief.seed % cntWorkers;
+    TaskNode *task = nullptr;
+
+    for ( std::size_t i = 0; i < cntWorkers; i++ ) {
+        Worker &victim = *m_workers[(first + i) % cntWorkers];
+        if ( &victim == &thief ) {
+            continue;
+        }
+        while ( !victim.deque.isEmpty() ) {
+            if ( victim.deque.steal(task) ) {
+                return task;
+            }
+        }
+    }
+
+    /* The LIFO slots are taken only when there is nothing else, so chains of
+     * continuations are rarely torn apart. A worker blocked in a task would
+     * hold the continuation in its slot forever otherwise. */
+    for ( std::size_t i = 0; i < cntWorkers; i++ ) {
+        Worker &victim = *m_workers[(first + i) % cntWorkers];
+        if ( &victim == &thief ||
+             victim.lifoSlot.load(std::memory_order_relaxed) == nullptr ) {
+            continue;
+        }
+        task = victim.lifoSlot.exchange(nullptr, std::memory_order_acq_rel);
+        if ( task != nullptr ) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(std::size_t cntWorkers)
+    : m_pool(std::make_unique<Pool>(this, cntWorkers))
+{
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() noexcept
+{
+    /* The timer thread schedules into the pool, so it must be done before
+     * the pool is gone. */
+    detail::dropSharedTimers(this);
+}
+
+void ThreadPoolExecutor::invoke(Task &&task) noexcept
+{
+    m_pool->invoke(std::move(task));
+}
+
+void ThreadPoolExecutor::schedule(TaskNode *node) noexcept
+{
+    m_pool->schedule(node);
+}
+
+bool ThreadPoolExecutor::isInExecutorThread() const noexcept
+{
+    return m_pool->isWorkerThread();
+}
+
+std::size_t ThreadPoolExecutor::size() const noexcept
+{
+    return m_pool->size();
+}
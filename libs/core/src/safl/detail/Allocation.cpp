@@ -0,0 +1,99 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/detail/Allocation.h>
+
+// Local includes:
+#include <safl/ContextPool.h>
+
+using namespace safl;
+
+#if SAFL_HAS_MEMORY_RESOURCE
+
+namespace {
+
+thread_local std::pmr::memory_resource *t_resource = nullptr;
+
+struct Header
+{
+    std::pmr::memory_resource *resource;
+};
+
+static_assert(sizeof(Header) <= detail::c_allocationHeaderSize,
+              "header must fit into its space");
+
+Header *headerOf(const void *object) noexcept
+{
+    return reinterpret_cast<Header*>(
+            const_cast<char*>(static_cast<const char*>(object)) -
+            detail::c_allocationHeaderSize);
+}
+
+} // anonymous namespace
+
+std::pmr::memory_resource *detail::currentMemoryResource() noexcept
+{
+    return t_resource;
+}
+
+void detail::setCurrentMemoryResource(std::pmr::memory_resource *resource) noexcept
+{
+    t_resource = resource;
+}
+
+std::pmr::memory_resource *detail::memoryResourceOf(const void *object) noexcept
+{
+    return headerOf(object)->resource;
+}
+
+void *detail::allocate(std::size_t size, bool isPooled)
+{
+    const std::size_t fullSize = size + c_allocationHeaderSize;
+    std::pmr::memory_resource *resource = t_resource;
+
+    void *memory;
+    if ( resource != nullptr ) {
+        memory = resource->allocate(fullSize, alignof(std::max_align_t));
+    } else if ( isPooled ) {
+        memory = ContextPool::allocate(fullSize);
+    } else {
+        memory = ::operator new(fullSize);
+    }
+
+    new (memory) Header{resource};
+    return static_cast<char*>(memory) + c_allocationHeaderSize;
+}
+
+void detail::deallocate(void *ptr, std::size_t size, bool isPooled) noexcept
+{
+    const std::size_t fullSize = size + c_allocationHeaderSize;
+    Header *header = headerOf(ptr);
+
+    if ( header->resource != nullptr ) {
+        header->resource->deallocate(header, fullSize, alignof(std::max_align_t));
+    } else if ( isPooled ) {
+        ContextPool::deallocate(header, fullSize);
+    } else {
+        ::operator delete(header);
+    }
+}
+
+#else
+
+void *detail::allocate(std::size_t size, bool isPooled)
+{
+    return isPooled ? ContextPool::allocate(size) : ::operator new(size);
+}
+
+void detail::deallocate(void *ptr, std::size_t size, bool isPooled) noexcept
+{
+    if ( isPooled ) {
+        ContextPool::deallocate(ptr, size);
+    } else {
+        ::operator delete(ptr);
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/detail/ConcurrentTaskQueue.h>
+
+using namespace safl::detail;
+
+ConcurrentTaskQueue::ConcurrentTaskQueue() noexcept
+    : m_head(&m_stub)
+    , m_tail(&m_stub)
+{
+}
+
+void ConcurrentTaskQueue::push(TaskNode *node) noexcept
+{
+    /* This is the only synchronisation between producers, so it is wait-free.
+     * Until the link is stored, the consumer sees the queue as inconsistent
+     * and does not proceed past the previous node. */
+    node->setNextNode(nullptr, std::memory_order_relaxed);
+    TaskNode *prev = m_head.exchange(node, std::memory_order_seq_cst);
+    prev->setNextNode(node, std::memory_order_release);
+}
+
+TaskNode *ConcurrentTaskQueue::pop() noexcept
+{
+    TaskNode *tail = m_tail;
+    TaskNode *next = tail->nextNode(std::memory_order_acquire);
+
+    if ( tail == &m_stub ) {
+        if ( next == nullptr ) {
+            return nullptr;
+        }
+        m_tail = next;
+        tail = next;
+        next = next->nextNode(std::memory_order_acquire);
+    }
+
+    if ( next != nullptr ) {
+        m_tail = next;
+        return tail;
+    }
+
+    if ( tail != m_head.load(std::memory_order_seq_cst) ) {
+        /* A producer is in the middle of pushing. */
+        return nullptr;
+    }
+
+    /* The last node is popped only when there is a node after it. */
+    push(&m_stub);
+    next = tail->nextNode(std::memory_order_acquire);
+    if ( next != nullptr ) {
+        m_tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+bool ConcurrentTaskQueue::isEmpty() const noexcept
+{
+    return m_tail == &m_stub &&
+           m_stub.nextNode(std::memory_order_acquire) == nullptr &&
+           m_head.load(std::memory_order_seq_cst) == &m_stub;
+}
@@ -9,17 +9,117 @@
 #include <safl/Executor.h>
 
 // Std includes:
+#include <algorithm>
 #include <cassert>
 
 using namespace safl::detail;
 
+namespace {
+
+/* The number of continuations nested in the call stack of this thread. */
+thread_local std::size_t t_inlineDepth = 0;
+
+} // anonymous namespace
+
+PrevList::~PrevList()
+{
+    if ( !m_isLent ) {
+        delete[] m_slots;
+    }
+}
+
+ContextNtBase *PrevList::front() const noexcept
+{
+    for ( auto *prev : *this ) {
+        if ( prev != nullptr ) {
+            return prev;
+        }
+    }
+    return nullptr;
+}
+
+std::size_t PrevList::indexOf(const ContextNtBase *prev) noexcept
+{
+    return prev->m_prevIndex;
+}
+
+bool PrevList::contains(const ContextNtBase *prev) const noexcept
+{
+    if ( m_slots != nullptr ) {
+        return prev->m_prevIndex < m_cntSlots && m_slots[prev->m_prevIndex] == prev;
+    }
+    return m_single == prev;
+}
+
+void PrevList::reserve(std::size_t cnt)
+{
+    if ( cnt > 1 ) {
+        spill(cnt);
+    }
+}
+
+/* The slots must outlive the list, and no more than @a cnt contexts may be
+ * inserted. */
+void PrevList::lend(ContextNtBase **slots, std::size_t cnt) noexcept
+{
+    assert(m_slots == nullptr && m_single == nullptr);
+    m_slots = slots;
+    m_capacity = static_cast<unsigned int>(cnt);
+    m_isLent = true;
+}
+
+void PrevList::insert(ContextNtBase *prev)
+{
+    if ( m_slots == nullptr ) {
+        if ( m_single == nullptr ) {
+            prev->m_prevIndex = 0;
+            m_single = prev;
+            return;
+        }
+        spill(2);
+    } else if ( m_cntSlots == m_capacity ) {
+        spill(2 * std::size_t(m_capacity));
+    }
+    prev->m_prevIndex = m_cntSlots;
+    m_slots[m_cntSlots++] = prev;
+    m_cntSpilled++;
+}
+
+void PrevList::erase(ContextNtBase *prev) noexcept
+{
+    assert(contains(prev));
+    if ( m_slots != nullptr ) {
+        m_slots[prev->m_prevIndex] = nullptr;
+        m_cntSpilled--;
+    } else {
+        m_single = nullptr;
+    }
+}
+
+void PrevList::spill(std::size_t cnt)
+{
+    if ( cnt <= m_capacity ) {
+        return;
+    }
+    assert(!m_isLent);
+    std::unique_ptr<ContextNtBase*[]> slots(new ContextNtBase*[cnt]);
+    if ( m_slots != nullptr ) {
+        std::copy(m_slots, m_slots + m_cntSlots, slots.get());
+        delete[] m_slots;
+    } else if ( m_single != nullptr ) {
+        slots[0] = m_single;
+        m_cntSlots = 1;
+        m_cntSpilled = 1;
+        m_single = nullptr;
+    }
+    m_slots = slots.release();
+    m_capacity = static_cast<unsigned int>(cnt);
+}
+
 ContextNtBase::ContextNtBase()
     : m_next(nullptr)
-    , m_isValueSet(false)
-    , m_isErrorForwarded(false)
-    , m_isShadow(false)
-    , m_hasFuture(false)
-    , m_hasPromise(false)
+    , m_executor(Executor::instance())
+    , m_state(0)
 {
 }
 
@@ -27,7 +127,13 @@ ContextNtBase::~ContextNtBase() = default;
 
 bool ContextNtBase::isReady() const
 {
-    return m_isValueSet || m_storedError || m_isErrorForwarded;
+    return hasState(ValueSet | ErrorForwarded | ErrorKept) || m_storedError;
+}
+
+bool ContextNtBase::hasResult() const
+{
+    /* Unlike isReady(), this can be safely called from any thread. */
+    return hasState(ValueSet | ErrorSet);
 }
 
 bool ContextNtBase::isFulfillable() const
@@ -35,15 +141,21 @@ bool ContextNtBase::isFulfillable() const
     /* The context is fulfillable if both a result can be achieved (e.g. a value
      * can be set by a previous context or a Promise), and the result can be used
      * (i.e. it can be propagated to the next context or accessed via a Future). */
-    return (m_hasPromise || m_prev.empty()) && (m_hasFuture || (m_next != nullptr));
+    return (hasState(HasPromise) || !hasState(HasPrev)) && hasState(HasFuture | HasTarget);
+}
+
+bool ContextNtBase::hasState(State mask) const noexcept
+{
+    return (m_state.load(std::memory_order_acquire) & mask) != 0;
 }
 
 void ContextNtBase::setValue()
 {
-    assert(!m_isValueSet);
-    assert(!m_storedError);
-    m_isValueSet = true;
-    if ( m_next != nullptr ) {
+    /* The value and the target may be set concurrently by different threads.
+     * Whoever comes second fulfils the context. */
+    const State old = m_state.fetch_or(ValueSet, std::memory_order_acq_rel);
+    assert(!(old & ValueSet));
+    if ( old & HasTarget ) {
         fulfil();
     }
 }
@@ -51,102 +163,318 @@ void ContextNtBase::setValue()
 void ContextNtBase::makeShadowOf(ContextNtBase *next)
 {
     DLOG("makeShadowOf: " << next->alias());
-    assert(!m_isShadow);
-    assert(m_hasFuture);
+    assert(!hasState(Shadow));
+    assert(hasState(HasFuture));
     assert(next->m_prev.size() == 1);
-    m_isShadow = true;
-    m_hasFuture = false;
-    (*next->m_prev.begin())->unsetTarget();
+    /* The future is not detached in a usual way, as the context is now owned
+     * by its new target. */
+    m_state.fetch_xor(Shadow | HasFuture, std::memory_order_acq_rel);
+    next->m_prev.front()->unsetTarget();
     setTarget(next);
 }
 
 void ContextNtBase::attachPromise()
 {
     DLOG("attachPromise");
-    assert(!m_hasPromise);
-    m_hasPromise = true;
+    acquire(HasPromise);
 }
 
 void ContextNtBase::detachPromise()
 {
     DLOG("detachPromise");
-    assert(m_hasPromise);
-    m_hasPromise = false;
-    tryDestroy();
+    release(HasPromise);
 }
 
 void ContextNtBase::attachFuture()
 {
     DLOG("attachFuture");
-    assert(!m_hasFuture);
-    m_hasFuture = true;
+    acquire(HasFuture);
 }
 
 void ContextNtBase::detachFuture(bool doTryDestroy)
 {
     DLOG("detachFuture");
-    assert(m_hasFuture);
-    m_hasFuture = false;
     if ( doTryDestroy ) {
-        tryDestroy();
+        /* A context which only holds a result is cancelled when its last
+         * consumer is gone. A continuation is kept, as it may be run for its
+         * side effects. Nothing may become a consumer concurrently, because
+         * targets are set through the future. */
+        if ( !runsContinuation() && !hasState(HasTarget | ValueSet | ErrorSet) ) {
+            cancel();
+        }
+        release(HasFuture);
+    } else {
+        assert(hasState(HasFuture));
+        m_state.fetch_and(~State{HasFuture}, std::memory_order_acq_rel);
     }
 }
 
+bool ContextNtBase::isValueShared() const noexcept
+{
+    /* The value may be read through the future, so it must stay intact. */
+    return hasState(HasFuture);
+}
+
 void ContextNtBase::setTarget(ContextNtBase *next, bool doMakeDirect)
 {
     DLOG("setTarget: " << next->alias() <<
-         (m_isShadow || doMakeDirect ? " (direct)" : ""));
+         (hasState(Shadow) || doMakeDirect ? " (direct)" : ""));
     assert(!m_next);
-    assert(next->m_prev.count(this) == 0);
+    assert(!next->m_prev.contains(this));
     m_next = next;
-    m_next->m_prev.insert(this);
-    m_isShadow = m_isShadow || doMakeDirect;
-    if ( m_isValueSet ) {
+    m_next->addPrev(this);
+    const State old = m_state.fetch_or(HasTarget | (doMakeDirect ? Shadow : 0u),
+                                       std::memory_order_acq_rel);
+    if ( old & ValueSet ) {
         fulfil();
     }
     if ( m_storedError ) {
         forwardError(std::move(m_storedError));
+    } else if ( old & ErrorKept ) {
+        m_state.fetch_and(~State{ErrorKept}, std::memory_order_acq_rel);
+        forwardError(releaseKeptError());
     }
 }
 
+ContextNtBase *ContextNtBase::tryDetachInput()
+{
+    /* Only a context whose input has not arrived yet, and which nothing but its
+     * future observes, may be replaced by another one. */
+    if ( m_prev.size() != 1 || m_next != nullptr || m_storedError ||
+         !m_errorHandlers.empty() ||
+         hasState(ValueSet | ErrorSet | InlinePolicy | PostPolicy | PendingMask) ) {
+        return nullptr;
+    }
+
+    /* The input is detached by clearing its target flag before its result is
+     * set, so a concurrent setValue() does not fulfil it. It must survive while
+     * it has no target. */
+    ContextNtBase *input = m_prev.front();
+    input->acquire(PendingTask);
+    State old = input->m_state.load(std::memory_order_acquire);
+    do {
+        if ( (old & (ValueSet | ErrorSet | Shadow)) || !(old & HasTarget) ) {
+            input->release(PendingTask);
+            return nullptr;
+        }
+    } while ( !input->m_state.compare_exchange_weak(old, old & ~State{HasTarget},
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_acquire) );
+    return input;
+}
+
+void ContextNtBase::replaceInput(ContextNtBase *input, ContextNtBase *ctx)
+{
+    DLOG("replaceInput: " << ctx->alias());
+    assert(input->m_next == this);
+    ctx->m_executor = m_executor;
+    ctx->m_state.fetch_or(m_state.load(std::memory_order_relaxed) & Bound,
+                          std::memory_order_relaxed);
+
+    input->m_next = ctx;
+    ctx->addPrev(input);
+    removePrev(input);
+
+    /* The value might have been set while the input had no target. */
+    const State old = input->m_state.fetch_or(HasTarget, std::memory_order_acq_rel);
+    if ( old & ValueSet ) {
+        input->fulfil();
+    }
+    input->release(PendingTask);
+}
+
+bool ContextNtBase::tryDetachFromTarget(const Signal *stopMessage)
+{
+    /* The target abandons this context, unless its result is on its way
+     * already. The target must guard its previous contexts while doing so,
+     * so this context is not removed concurrently. The message is sent
+     * before, as it may keep this context alive until it is handled. */
+    if ( stopMessage != nullptr && *stopMessage ) {
+        routeMessage(stopMessage->share());
+    }
+
+    /* The context survives its own cancellation with a pending task. */
+    State old = m_state.load(std::memory_order_acquire);
+    do {
+        if ( (old & (ValueSet | ErrorSet)) || !(old & HasTarget) ) {
+            return false;
+        }
+    } while ( !m_state.compare_exchange_weak(old, (old & ~State{HasTarget}) + PendingTask,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire) );
+
+    DLOG("detachFromTarget: " << m_next->alias());
+    m_next->forgetPrev(this);
+    m_next = nullptr;
+
+    /* Nobody else waits for the result. */
+    if ( !(old & HasFuture) ) {
+        cancel();
+    }
+    release(PendingTask);
+    return true;
+}
+
+void ContextNtBase::cancel() noexcept
+{
+    /* The caller keeps this context alive. */
+    const State old = m_state.fetch_or(Cancelled);
+    if ( old & (Cancelled | ValueSet | ErrorSet) ) {
+        return;
+    }
+
+    DLOG("cancel");
+    acceptCancel();
+}
+
+bool ContextNtBase::isCancelled() const noexcept
+{
+    return (m_state.load() & Cancelled) != 0;
+}
+
+bool ContextNtBase::abandonPrevs() noexcept
+{
+    /* Previous contexts whose results are on their way are removed as usual.
+     * Returns true if the last one has been detached here. */
+    bool isDetached = false;
+    for ( auto *prev : m_prev ) {
+        if ( prev != nullptr && prev->tryDetachFromTarget(nullptr) ) {
+            isDetached = true;
+        }
+    }
+    return isDetached && m_prev.empty();
+}
+
+void ContextNtBase::bindTo(Executor *executor) noexcept
+{
+    /* Only a context which has not been published yet may be bound. */
+    if ( executor != nullptr ) {
+        m_executor = executor;
+        m_state.fetch_or(Bound, std::memory_order_relaxed);
+    }
+}
+
+safl::Executor *ContextNtBase::boundExecutor() const noexcept
+{
+    return hasState(Bound) ? m_executor : nullptr;
+}
+
+const void *ContextNtBase::allocation() const noexcept
+{
+    /* The most derived object is the one which has been allocated. */
+    return dynamic_cast<const void*>(this);
+}
+
 void ContextNtBase::unsetTarget()
 {
     if ( m_next != nullptr ) {
         DLOG("unsetTarget: " << m_next->alias());
-        assert(m_next->m_prev.count(this) == 1);
-        m_next->m_prev.erase(this);
-        m_next->tryDestroy();
+        ContextNtBase *next = m_next;
         m_next = nullptr;
-        tryDestroy();
+        next->removePrev(this);
+        release(HasTarget);
     }
 }
 
 void ContextNtBase::fulfil()
 {
-    DLOG("fulfil" << (m_isShadow ? " (direct)" : ""));
-    assert(Executor::instance() != nullptr);
+    const bool isDirect = hasState(Shadow) || m_next->isInlined();
+    DLOG("fulfil" << (isDirect ? " (direct)" : ""));
+
+    /* The input is accepted by the next context, so it happens in the executor
+     * of the next context. A direct fulfilment must not happen outside of its
+     * thread. Otherwise, the context queues itself, which does not allocate,
+     * or is queued by the batch scope of this thread.
+     * Deep chains of direct fulfilments are trampolined through the executor,
+     * which bounds the stack. */
+    Executor *executor = m_next->m_executor;
+    assert(executor != nullptr);
+
+    if ( isDirect && executor->isInExecutorThread() &&
+         t_inlineDepth < Executor::maxInlineDepth() ) {
+        t_inlineDepth++;
+        run();
+        t_inlineDepth--;
+    } else if ( !BatchScope::defer(executor, this) ) {
+        executor->schedule(this);
+    }
+}
 
-    auto doFulfil = [this]()
+void ContextNtBase::setContinuationPolicy(ContinuationPolicy policy) noexcept
+{
+    /* Only a context which has not been published yet may be changed. */
+    switch ( policy ) {
+    case ContinuationPolicy::Default:
+        break;
+    case ContinuationPolicy::Post:
+        m_state.fetch_or(PostPolicy, std::memory_order_relaxed);
+        break;
+    case ContinuationPolicy::Inline:
+        m_state.fetch_or(InlinePolicy, std::memory_order_relaxed);
+        break;
+    }
+}
+
+bool ContextNtBase::isInlined() const noexcept
+{
+    if ( hasState(InlinePolicy | PostPolicy) ) {
+        return hasState(InlinePolicy);
+    }
+    return m_executor->continuationPolicy() == ContinuationPolicy::Inline;
+}
+
+void ContextNtBase::run() noexcept
+{
+    /* m_next will not be deleted by acceptInput() because m_next->m_prev
+     * is not null, so it is safe to operate on it. */
+    m_next->acceptInput(this);
+
+    /* This disconnects this and the next contexts. One or both of them might
+     * be destroyed in process. */
+    unsetTarget();
+}
+
+void ContextNtBase::publishError(Signal &&error)
+{
+    m_state.fetch_or(ErrorSet, std::memory_order_acq_rel);
+    assert(m_executor != nullptr);
+
+    if ( m_executor->isInExecutorThread() ) {
+        storeError(std::move(error));
+        return;
+    }
+
+    /* Error handlers and next contexts may be accessed only in the executor
+     * thread, so the error is dispatched there. */
+    acquire(PendingTask);
+    m_executor->invoke([this, error = std::move(error)]() mutable
     {
-        /* m_next will not be deleted by acceptInput() because m_next->m_prev
-         * is not null, so it is safe to operate on it. */
-        m_next->acceptInput(this);
+        storeError(std::move(error));
+        release(PendingTask);
+    });
+}
 
-        /* This disconnects this and the next contexts. One or both of them might
-         * be destroyed in process. */
-        unsetTarget();
-    };
+void ContextNtBase::publishKeptError()
+{
+    m_state.fetch_or(ErrorSet, std::memory_order_acq_rel);
+    assert(m_executor != nullptr);
 
-    if ( m_isShadow ) {
-        doFulfil();
-    } else {
-        Executor::instance()->invoke(std::move(doFulfil));
+    if ( m_executor->isInExecutorThread() ) {
+        storeKeptError();
+        return;
     }
+
+    acquire(PendingTask);
+    m_executor->invoke([this]()
+    {
+        storeKeptError();
+        release(PendingTask);
+    });
 }
 
 void ContextNtBase::storeError(Signal &&error)
 {
-    assert(!m_isValueSet);
+    assert(!hasState(ValueSet));
     assert(!m_storedError);
 
     /* Search for an appropriate error handler. */
@@ -169,15 +497,31 @@ void ContextNtBase::forwardError(Signal &&error)
 
     /* Mark this context as fulfilled. This will make isReady() return a valid
      * value and prevent reporting a broken promise. */
-    m_isErrorForwarded = true;
+    m_state.fetch_or(ErrorForwarded, std::memory_order_acq_rel);
 
     /* This disconnects this and the next contexts. One or both of them might
      * be destroyed in process. */
     unsetTarget();
 }
 
+void ContextNtBase::storeKeptError()
+{
+    /* The error stays in the slot of the context until it has a consumer. */
+    if ( m_next == nullptr && m_errorHandlers.empty() ) {
+        m_state.fetch_or(ErrorKept, std::memory_order_acq_rel);
+        return;
+    }
+    storeError(releaseKeptError());
+}
+
 void ContextNtBase::addErrorHandler(SignalHandler &&handler)
 {
+    /* Error handlers do not know the set of a kept error. */
+    if ( hasState(ErrorKept) && !m_storedError ) {
+        m_state.fetch_and(~State{ErrorKept}, std::memory_order_acq_rel);
+        m_storedError = releaseKeptError();
+    }
+
     /* Maybe the new error handler can handle a stored error? */
     if ( m_storedError ) {
         tryHandleSignal(m_storedError, handler);
@@ -188,11 +532,13 @@ void ContextNtBase::addErrorHandler(SignalHandler &&handler)
 
 bool ContextNtBase::tryHandleSignal(Signal &sig, SignalHandler &handler)
 {
-    if ( handler->isOfTypeAs(sig) ) {
-        Executor::instance()->
-                invoke([this, sig = std::move(sig), handler = std::move(handler)]()
+    if ( handler->isType(sig->type()) ) {
+        /* The context must survive until the handler is invoked. */
+        acquire(PendingTask);
+        m_executor->invoke([this, sig = std::move(sig), handler = std::move(handler)]()
         {
             handler->accept(this, sig.get());
+            release(PendingTask);
         });
         return true;
     }
@@ -210,15 +556,95 @@ bool ContextNtBase::tryHandleSignal(
     return false;
 }
 
+void ContextNtBase::dispatchMessage(Executor *executor, SignalHandlerNtBase *handler,
+                                    Signal &&msg) noexcept
+{
+    /* The handler is owned by this context, which must survive until the
+     * handler is invoked. A coalescing handler is invoked once for all
+     * messages which arrive until then, with the latest one. */
+    MessageSlot *slot = handler->messageSlot();
+    if ( slot == nullptr ) {
+        acquire(PendingTask);
+        executor->invoke([this, handler, msg = std::move(msg)]()
+        {
+            handler->accept(this, msg.get());
+            release(PendingTask);
+        });
+    } else if ( slot->put(std::move(msg)) ) {
+        acquire(PendingTask);
+        executor->invoke([this, handler, slot]()
+        {
+            const Signal msg = slot->take();
+            handler->accept(this, msg.get());
+            release(PendingTask);
+        });
+    }
+}
+
+void ContextNtBase::routeMessage(Signal &&msg) noexcept
+{
+    /* The message must be sent to the currently running context, which the
+     * route leads to directly. */
+    if ( ContextNtBase *route = messageRoute() ) {
+        route->acceptMessage(std::move(msg));
+    }
+}
+
+bool ContextNtBase::handlesMessages() const noexcept
+{
+    return false;
+}
+
 void ContextNtBase::acceptMessage(Signal &&msg) noexcept
 {
-    /* The message must be sent to the currently running context. */
     if ( m_prev.size() == 1 ) {
         /* Handle the most common case. */
-        (*m_prev.begin())->acceptMessage(std::move(msg));
+        m_prev.front()->routeMessage(std::move(msg));
     } else {
+        /* Large data is shared by all previous contexts, not copied. */
         for ( auto *prev : m_prev ) {
-            prev->acceptMessage(msg->clone());
+            if ( prev != nullptr ) {
+                prev->routeMessage(msg.share());
+            }
+        }
+    }
+}
+
+ContextNtBase *ContextNtBase::messageRoute() const noexcept
+{
+    if ( handlesMessages() ) {
+        return const_cast<ContextNtBase*>(this);
+    }
+    return m_route.load(std::memory_order_acquire);
+}
+
+void ContextNtBase::updateRoute() noexcept
+{
+    if ( handlesMessages() ) {
+        return;
+    }
+
+    /* A context with a single input forwards messages along the route of the
+     * input, and one with many inputs passes them to each. The route is
+     * pushed down the chain of forwarding contexts when inputs change, so a
+     * message takes a single hop however long the chain is. */
+    ContextNtBase *route = m_prev.size() > 1 ? this
+                         : m_prev.empty() ? nullptr
+                         : m_prev.front()->messageRoute();
+    ContextNtBase *ctx = this;
+    while ( ctx->m_route.load(std::memory_order_relaxed) != route ) {
+        ctx->m_route.store(route, std::memory_order_release);
+
+        /* The target is read only after it has been set, and while the result
+         * of the context is not on its way, when the target may be released
+         * by another thread. */
+        const State state = ctx->m_state.load(std::memory_order_acquire);
+        if ( (state & (ValueSet | ErrorSet)) || !(state & HasTarget) ) {
+            break;
+        }
+        ctx = ctx->m_next;
+        if ( ctx->handlesMessages() || ctx->m_prev.size() != 1 ) {
+            break;
         }
     }
 }
@@ -227,20 +653,90 @@ void ContextNtBase::addMessageHandler(SignalHandler &&/*handler*/)
 {
 }
 
+void ContextNtBase::addCancelHandler(Task &&/*handler*/)
+{
+}
+
+void ContextNtBase::addProgressHandler(SignalHandler &&/*handler*/, Executor */*executor*/)
+{
+}
+
+void ContextNtBase::acceptProgress(Signal &&/*progress*/) noexcept
+{
+}
+
+void ContextNtBase::acceptCancel() noexcept
+{
+    if ( abandonPrevs() ) {
+        release(HasPrev);
+    }
+}
+
+bool ContextNtBase::runsContinuation() const noexcept
+{
+    return false;
+}
+
 void ContextNtBase::acceptError(ContextNtBase *ctx, Signal &&error) noexcept
 {
     (void)ctx;
-    assert(m_prev.count(ctx) == 1);
-    storeError(std::move(error));
+    assert(m_prev.contains(ctx));
+
+    /* The previous context may belong to another executor. */
+    publishError(std::move(error));
+}
+
+Signal ContextNtBase::releaseKeptError() noexcept
+{
+    return Signal();
 }
 
 void ContextNtBase::acceptInput(ContextNtBase */*ctx*/)
 {
 }
 
-void ContextNtBase::tryDestroy()
+void ContextNtBase::addPrev(ContextNtBase *prev)
+{
+    assert(!m_prev.contains(prev));
+    if ( m_prev.empty() ) {
+        acquire(HasPrev);
+    }
+    m_prev.insert(prev);
+    updateRoute();
+}
+
+void ContextNtBase::forgetPrev(ContextNtBase *prev) noexcept
+{
+    /* Unlike removePrev(), the caller releases HasPrev, see abandonPrevs(). */
+    m_prev.erase(prev);
+    updateRoute();
+}
+
+void ContextNtBase::removePrev(ContextNtBase *prev)
+{
+    assert(m_prev.contains(prev));
+    m_prev.erase(prev);
+    updateRoute();
+    if ( m_prev.empty() ) {
+        release(HasPrev);
+    }
+}
+
+void ContextNtBase::acquire(State owner) noexcept
+{
+    const State old = m_state.fetch_add(owner, std::memory_order_acq_rel);
+    (void)old;
+    assert(owner == PendingTask || !(old & owner));
+}
+
+void ContextNtBase::release(State owner)
 {
-    if ( !(m_hasPromise || m_hasFuture || !m_prev.empty() || (m_next != nullptr)) ) {
+    /* Owners may be released concurrently by different threads, e.g. a promise
+     * by a worker thread and a future by the executor thread. Exactly one of
+     * them observes that it was the last owner. */
+    const State old = m_state.fetch_sub(owner, std::memory_order_acq_rel);
+    assert(old & (owner == PendingTask ? State{PendingMask} : owner));
+    if ( (old & OwnerMask) == owner ) {
         delete this;
     }
 }
@@ -5,10 +5,14 @@
 // Self-include:
 #include <safl/detail/DebugContext.h>
 
+// Std includes:
+#include <atomic>
+
 using namespace safl::detail;
 
-static unsigned int s_nextAlias = 0;
-static unsigned int s_cntContexts = 0;
+/* Contexts may be created and destroyed in different threads. */
+static std::atomic<unsigned int> s_nextAlias{0};
+static std::atomic<unsigned int> s_cntContexts{0};
 
 unsigned int DebugContext::cntContexts() noexcept
 {
@@ -0,0 +1,350 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+// Self-include:
+#include <safl/detail/Timer.h>
+
+// Std includes:
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#ifdef SAFL_HAS_FUTEX
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#endif
+
+using namespace safl;
+using namespace safl::detail;
+
+namespace {
+
+/* The heap keeps the earliest timer on its top. */
+bool isLater(const TimerNode *a, const TimerNode *b) noexcept
+{
+    return b->isBefore(a);
+}
+
+/* The timer thread of executors which have no timers of their own. It is
+ * started with the first timer and lives as long as the process, as timers
+ * may be started by static objects. Executors drop their timers when they are
+ * destroyed, so the thread never touches a destroyed executor. */
+class SharedTimers
+{
+    using Clock = TimerNode::Clock;
+
+public:
+    void start(TimerNode *timer)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if ( !m_isStarted ) {
+            std::thread thread([this]() { run(); });
+            m_threadId = thread.get_id();
+            thread.detach();
+            m_isStarted = true;
+        }
+        const bool isFirst = m_queue.push(timer);
+        lock.unlock();
+
+        /* The thread recomputes its timeout only for a new first timer. */
+        if ( isFirst ) {
+            wake();
+        }
+    }
+
+    /* If the thread is expiring a timer of the executor right now, this waits
+     * until the timer is scheduled, which takes a single call. */
+    void drop(const Executor *executor) noexcept
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queue.discardOf(executor);
+        for ( auto &timer : m_expired ) {
+            if ( timer != nullptr && timer->executor() == executor ) {
+                timer->discard();
+                timer = nullptr;
+            }
+        }
+        if ( std::this_thread::get_id() == m_threadId ) {
+            return;
+        }
+        while ( m_expiringExecutor == executor ) {
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+
+private:
+    void run() noexcept
+    {
+        for ( ;; ) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            const Clock::time_point now = Clock::now();
+            while ( TimerNode *timer = m_queue.popDue(now) ) {
+                m_expired.push_back(timer);
+            }
+
+            /* Timers are expired without the lock, because executors may run
+             * their tasks right away, which may start new timers. */
+            for ( auto &timer : m_expired ) {
+                if ( timer == nullptr ) {
+                    continue;
+                }
+                TimerNode *expired = timer;
+                timer = nullptr;
+                m_expiringExecutor = expired->executor();
+                lock.unlock();
+                expired->expire();
+                lock.lock();
+                m_expiringExecutor = nullptr;
+            }
+            m_expired.clear();
+
+            /* A timer started after the epoch is read changes it, so the wait
+             * returns immediately. */
+            const std::uint32_t epoch = m_epoch.load(std::memory_order_seq_cst);
+            const bool isIdle = m_queue.isEmpty();
+            const Clock::duration timeout = isIdle ? Clock::duration::zero()
+                                                   : m_queue.nextDeadline() - now;
+            lock.unlock();
+
+            wait(epoch, isIdle ? nullptr : &timeout);
+        }
+    }
+
+    void wait(std::uint32_t epoch, const Clock::duration *timeout) noexcept
+    {
+#ifdef SAFL_HAS_FUTEX
+        timespec ts{};
+        if ( timeout != nullptr ) {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*timeout);
+            ts.tv_sec = static_cast<std::time_t>(ns.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+        }
+        syscall(SYS_futex, futexWord(), FUTEX_WAIT_PRIVATE, epoch,
+                timeout != nullptr ? &ts : nullptr, nullptr, 0);
+#else
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        auto isWoken = [&]()
+        {
+            return m_epoch.load(std::memory_order_seq_cst) != epoch;
+        };
+        if ( timeout != nullptr ) {
+            m_cv.wait_for(lock, *timeout, isWoken);
+        } else {
+            m_cv.wait(lock, isWoken);
+        }
+#endif
+    }
+
+    void wake() noexcept
+    {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+#ifdef SAFL_HAS_FUTEX
+        syscall(SYS_futex, futexWord(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_waitMutex);
+        }
+        m_cv.notify_one();
+#endif
+    }
+
+#ifdef SAFL_HAS_FUTEX
+    std::uint32_t *futexWord() noexcept
+    {
+        static_assert(sizeof(m_epoch) == sizeof(std::uint32_t),
+                      "futex requires a plain 32-bit word");
+        return reinterpret_cast<std::uint32_t*>(&m_epoch);
+    }
+#endif
+
+private:
+    std::mutex m_mutex;
+    TimerQueue m_queue;
+    bool m_isStarted = false;
+    std::thread::id m_threadId;
+
+    /* Timers taken from the queue, and the executor of the one which is being
+     * expired. */
+    std::vector<TimerNode*> m_expired;
+    const Executor *m_expiringExecutor = nullptr;
+
+    std::atomic<std::uint32_t> m_epoch{0};
+#ifndef SAFL_HAS_FUTEX
+    std::mutex m_waitMutex;
+    std::condition_variable m_cv;
+#endif
+};
+
+SharedTimers &sharedTimers()
+{
+    static SharedTimers *s_timers = new SharedTimers();
+    return *s_timers;
+}
+
+} // anonymous namespace
+
+TimerNode::TimerNode(Executor *executor, Clock::time_point deadline, Task &&task) noexcept
+    : m_executor(executor)
+    , m_deadline(deadline)
+    , m_task(std::move(task))
+{
+}
+
+bool TimerNode::isCancelled() const noexcept
+{
+    return m_state.load(std::memory_order_acquire) == Cancelled;
+}
+
+bool TimerNode::cancel() noexcept
+{
+    unsigned int state = Armed;
+    return m_state.compare_exchange_strong(state, Cancelled, std::memory_order_acq_rel);
+}
+
+void TimerNode::release() noexcept
+{
+    if ( m_cntRefs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+        delete this;
+    }
+}
+
+void TimerNode::expire() noexcept
+{
+    /* The task runs in the executor, unless the timer is cancelled before. */
+    m_executor->schedule(this);
+}
+
+void TimerNode::discard() noexcept
+{
+    /* The task may own objects which refer to the owner of the timer, so it
+     * is destroyed as soon as the queue is done with the timer. */
+    Task task(std::move(m_task));
+    release();
+}
+
+void TimerNode::run() noexcept
+{
+    Task task(std::move(m_task));
+    unsigned int state = Armed;
+    if ( m_state.compare_exchange_strong(state, Fired, std::memory_order_acq_rel) ) {
+        task.invoke();
+    }
+    release();
+}
+
+TimerQueue::~TimerQueue()
+{
+    clear();
+}
+
+bool TimerQueue::isEmpty() noexcept
+{
+    dropCancelled();
+    return m_heap.empty();
+}
+
+TimerQueue::Clock::time_point TimerQueue::nextDeadline() noexcept
+{
+    dropCancelled();
+    assert(!m_heap.empty());
+    return m_heap.front()->deadline();
+}
+
+bool TimerQueue::push(TimerNode *timer)
+{
+    if ( m_heap.size() >= m_compactSize ) {
+        compact();
+    }
+
+    timer->setSequence(m_sequence++);
+    m_heap.push_back(timer);
+    std::push_heap(m_heap.begin(), m_heap.end(), isLater);
+    return m_heap.front() == timer;
+}
+
+TimerNode *TimerQueue::popDue(Clock::time_point now) noexcept
+{
+    dropCancelled();
+    if ( m_heap.empty() || m_heap.front()->deadline() > now ) {
+        return nullptr;
+    }
+    return pop();
+}
+
+void TimerQueue::clear() noexcept
+{
+    for ( TimerNode *timer : m_heap ) {
+        timer->discard();
+    }
+    m_heap.clear();
+}
+
+void TimerQueue::discardOf(const Executor *executor) noexcept
+{
+    auto end = std::partition(m_heap.begin(), m_heap.end(), [&](const TimerNode *timer)
+    {
+        return timer->executor() != executor;
+    });
+    for ( auto it = end; it != m_heap.end(); ++it ) {
+        (*it)->discard();
+    }
+    m_heap.erase(end, m_heap.end());
+    std::make_heap(m_heap.begin(), m_heap.end(), isLater);
+}
+
+void TimerQueue::dropCancelled() noexcept
+{
+    while ( !m_heap.empty() && m_heap.front()->isCancelled() ) {
+        pop()->discard();
+    }
+}
+
+void TimerQueue::compact() noexcept
+{
+    /* Each timer is scanned once per doubling of the heap, so cancelling stays
+     * O(1) amortised. */
+    auto end = std::partition(m_heap.begin(), m_heap.end(), [](const TimerNode *timer)
+    {
+        return !timer->isCancelled();
+    });
+    for ( auto it = end; it != m_heap.end(); ++it ) {
+        (*it)->discard();
+    }
+    m_heap.erase(end, m_heap.end());
+    std::make_heap(m_heap.begin(), m_heap.end(), isLater);
+    m_compactSize = std::max<std::size_t>(64, 2 * m_heap.size());
+}
+
+TimerNode *TimerQueue::pop() noexcept
+{
+    std::pop_heap(m_heap.begin(), m_heap.end(), isLater);
+    TimerNode *timer = m_heap.back();
+    m_heap.pop_back();
+    return timer;
+}
+
+TimerHandle safl::detail::startTimer(Executor *executor, Executor::Clock::duration delay,
+                                     Task &&task)
+{
+    auto *timer = new TimerNode(executor, executor->now() + delay, std::move(task));
+    executor->startTimer(timer);
+    return TimerHandle(timer);
+}
+
+void safl::detail::startSharedTimer(TimerNode *timer)
+{
+    sharedTimers().start(timer);
+}
+
+void safl::detail::dropSharedTimers(const Executor *executor) noexcept
+{
+    sharedTimers().drop(executor);
+}
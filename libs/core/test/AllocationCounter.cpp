@@ -0,0 +1,165 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace safl::testing;
+
+namespace {
+
+/* Replace the global allocation functions to count allocations in tests. */
+thread_local std::size_t t_cntAllocations = 0;
+
+void *allocate(std::size_t size) noexcept
+{
+    t_cntAllocations++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocateOrThrow(std::size_t size)
+{
+    if ( void *ptr = allocate(size) ) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+#ifdef __cpp_aligned_new
+void *allocate(std::size_t size, std::align_val_t alignment) noexcept
+{
+    t_cntAllocations++;
+    const auto align = static_cast<std::size_t>(alignment);
+    /* The size must be a multiple of the alignment. */
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+void *allocateOrThrow(std::size_t size, std::align_val_t alignment)
+{
+    if ( void *ptr = allocate(size, alignment) ) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+#endif
+
+} // anonymous namespace
+
+void *operator new(std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+#ifdef __cpp_aligned_new
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept
+{
+    return allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept
+{
+    return allocate(size, alignment);
+}
+
+void operator delete(void *ptr, std::align_val_t /*alignment*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t /*alignment*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t /*size*/, std::align_val_t /*alignment*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t /*alignment*/,
+                     const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t /*alignment*/,
+                       const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+AllocationCounter::AllocationCounter() noexcept
+    : m_start(t_cntAllocations)
+{
+}
+
+std::size_t AllocationCounter::count() const noexcept
+{
+    return t_cntAllocations - m_start;
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace safl {
+namespace testing {
+
+/**
+ * @brief Count heap allocations made by the current thread during its lifetime.
+ *
+ * The global allocation functions are replaced only in the unit tests, so the
+ * counts include every form of operator new.
+ */
+class AllocationCounter
+{
+public:
+    AllocationCounter() noexcept;
+    std::size_t count() const noexcept;
+
+private:
+    std::size_t m_start;
+};
+
+} // namespace testing
+} // namespace safl
@@ -0,0 +1,155 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include <safl/Composition.h>
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+class CancellationTest
+        : public Test
+{
+};
+
+} // anonymous namespace
+
+TEST_F(CancellationTest, droppedFutureCancelsPromise)
+{
+    Promise<int> p;
+    bool isCancelled = false;
+    p.onCancel([&]() { isCancelled = true; });
+
+    {
+        auto f = p.future();
+    }
+    EXPECT_TRUE(p.isCancelled());
+    EXPECT_SMTH_INVOKED();
+    EXPECT_TRUE(isCancelled);
+}
+
+TEST_F(CancellationTest, lateHandlerIsInvoked)
+{
+    Promise<void> p;
+    p.future().cancel();
+    EXPECT_TRUE(p.isCancelled());
+
+    bool isCancelled = false;
+    p.onCancel([&]() { isCancelled = true; });
+    EXPECT_SMTH_INVOKED();
+    EXPECT_TRUE(isCancelled);
+}
+
+TEST_F(CancellationTest, cancelledChainIsNotRun)
+{
+    Promise<int> p;
+    bool isCalled = false;
+    auto f = p.future().then([](int value)
+    {
+        return value + 1;
+    }).then([&](int)
+    {
+        isCalled = true;
+    });
+
+    f.cancel();
+    EXPECT_TRUE(p.isCancelled());
+
+    p.setValue(1);
+    processAll();
+    EXPECT_FALSE(isCalled);
+    EXPECT_FALSE(f.isReady());
+}
+
+TEST_F(CancellationTest, droppedContinuationIsRun)
+{
+    Promise<int> p;
+    bool isCalled = false;
+    p.future().then([&](int)
+    {
+        isCalled = true;
+    });
+
+    EXPECT_FALSE(p.isCancelled());
+    p.setValue(1);
+    processAll();
+    EXPECT_TRUE(isCalled);
+}
+
+TEST_F(CancellationTest, namedFutureKeepsPromise)
+{
+    Promise<int> p;
+    {
+        auto f = p.future();
+        auto g = f.then([](int value)
+        {
+            return value + 1;
+        });
+
+        g.cancel();
+        EXPECT_FALSE(p.isCancelled());
+    }
+    EXPECT_TRUE(p.isCancelled());
+}
+
+TEST_F(CancellationTest, cancelReachesInnerPromise)
+{
+    Promise<int> p;
+    Promise<int> inner;
+    auto f = p.future().then([&](int)
+    {
+        return inner.future();
+    });
+
+    p.setValue(1);
+    processAll();
+    EXPECT_FALSE(inner.isCancelled());
+
+    f.cancel();
+    EXPECT_TRUE(inner.isCancelled());
+}
+
+TEST_F(CancellationTest, droppedCollectCancelsInputs)
+{
+    ProfutVector<int> v(3);
+    v.p[1].setValue(1);
+
+    {
+        auto f = collect(v.f);
+    }
+    processAll();
+    EXPECT_TRUE(v.p[0].isCancelled());
+    EXPECT_FALSE(v.p[1].isCancelled());
+    EXPECT_TRUE(v.p[2].isCancelled());
+}
+
+TEST_F(CancellationTest, droppedTupleCollectCancelsInputs)
+{
+    Promise<int> p1;
+    Promise<void> p2;
+
+    {
+        auto f1 = p1.future();
+        auto f2 = p2.future();
+        auto f = collect(f1, f2);
+    }
+    EXPECT_TRUE(p1.isCancelled());
+    EXPECT_TRUE(p2.isCancelled());
+}
+
+TEST_F(CancellationTest, collectAnyCancelsLosers)
+{
+    ProfutVector<int> v(3);
+
+    auto f = collectAny(v.f);
+    v.p[1].setValue(1);
+    processAll();
+
+    EXPECT_TRUE(f.isReady());
+    EXPECT_TRUE(v.p[0].isCancelled());
+    EXPECT_FALSE(v.p[1].isCancelled());
+    EXPECT_TRUE(v.p[2].isCancelled());
+}
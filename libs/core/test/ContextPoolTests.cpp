@@ -0,0 +1,130 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include "AllocationCounter.h"
+#include <safl/ContextPool.h>
+
+#include <thread>
+#include <vector>
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+class ContextPoolTest
+        : public Test
+{
+public:
+    static std::size_t cntLive()
+    {
+        std::size_t cnt = 0;
+        for ( const auto &stats : ContextPool::stats() ) {
+            cnt += stats.cntLive;
+        }
+        return cnt;
+    }
+
+    static std::size_t bytesReserved()
+    {
+        std::size_t bytes = 0;
+        for ( const auto &stats : ContextPool::stats() ) {
+            bytes += stats.bytesReserved;
+        }
+        return bytes;
+    }
+};
+
+} // anonymous namespace
+
+TEST_F(ContextPoolTest, statsCountLiveContexts)
+{
+    const std::size_t cntLiveBefore = cntLive();
+    {
+        Promise<int> p;
+        auto f = p.future().then([](int value)
+        {
+            return value;
+        });
+        EXPECT_EQ(cntLiveBefore + 2, cntLive());
+        EXPECT_LT(0u, bytesReserved());
+    }
+    EXPECT_EQ(cntLiveBefore, cntLive());
+}
+
+TEST_F(ContextPoolTest, fusedStagesShareContext)
+{
+    const std::size_t cntLiveBefore = cntLive();
+    {
+        Promise<int> p;
+        auto f = p.future().then([](int value)
+        {
+            return value + 1;
+        }).then([](int value)
+        {
+            return value * 2;
+        }).then([](int value)
+        {
+            return value - 1;
+        });
+        EXPECT_EQ(cntLiveBefore + 2, cntLive());
+
+        p.setValue(20);
+        EXPECT_FUTURE_FULFILLED();
+        EXPECT_EQ(41, f.value());
+    }
+    EXPECT_EQ(cntLiveBefore, cntLive());
+}
+
+TEST_F(ContextPoolTest, reservedContextsDoNotAllocate)
+{
+    constexpr std::size_t c_cntPromises = 10000;
+    ContextPool::reserve(sizeof(detail::InitialContext<int>), c_cntPromises);
+
+    AllocationCounter counter;
+    {
+        std::vector<Promise<int>> promises(c_cntPromises);
+        EXPECT_EQ(1u, counter.count());
+    }
+    EXPECT_EQ(1u, counter.count());
+}
+
+TEST_F(ContextPoolTest, contextsAreReused)
+{
+    {
+        Promise<int> p;
+    }
+
+    AllocationCounter counter;
+    for ( int i = 0; i < 1000; i++ ) {
+        Promise<int> p;
+    }
+    EXPECT_EQ(0u, counter.count());
+}
+
+TEST_F(ContextPoolTest, contextsFreedByOtherThreads)
+{
+    constexpr std::size_t c_cntPromises = 100;
+    const std::size_t cntLiveBefore = cntLive();
+
+    std::vector<Promise<int>> promises;
+    promises.reserve(c_cntPromises);
+    std::thread([&]()
+    {
+        for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+            promises.emplace_back();
+        }
+    }).join();
+    EXPECT_EQ(cntLiveBefore + c_cntPromises, cntLive());
+
+    /* The heap of the exited thread gets the blocks back when another thread
+     * adopts it. */
+    promises.clear();
+    std::thread([]()
+    {
+        Promise<int> p;
+    }).join();
+    EXPECT_EQ(cntLiveBefore, cntLive());
+}
@@ -3,6 +3,10 @@
  */
 
 #include <safl/testing/Testing.h>
+#include <safl/ContextPool.h>
+#include "AllocationCounter.h"
+
+#include <array>
 
 using namespace safl;
 using namespace safl::testing;
@@ -14,6 +18,37 @@ class CoreTest
 {
 };
 
+/* Counts its copies, which must not happen when values are moved through. */
+class Counted
+{
+public:
+    explicit Counted(int value) noexcept
+        : m_value(value)
+    {
+    }
+
+    Counted(const Counted &other) noexcept
+        : m_value(other.m_value)
+    {
+        s_cntCopies++;
+    }
+
+    Counted(Counted &&other) noexcept = default;
+
+    int value() const noexcept
+    {
+        return m_value;
+    }
+
+public:
+    static int s_cntCopies;
+
+private:
+    int m_value;
+};
+
+int Counted::s_cntCopies = 0;
+
 } // anonymous namespace
 
 TEST_F(CoreTest, canCreatePromisePod)
@@ -52,10 +87,7 @@ TEST_F(CoreTest, valueThenLambda)
 
     p.setValue(42);
 
-    EXPECT_FUTURE_FULFILLED();
-    EXPECT_EQ(42, calledWith);
-    EXPECT_FALSE(secondLambdaCalled);
-
+    /* Both lambdas are fused into a single continuation. */
     EXPECT_FUTURE_FULFILLED();
     EXPECT_EQ(42, calledWith);
     EXPECT_TRUE(secondLambdaCalled);
@@ -201,6 +233,181 @@ TEST_F(CoreTest, onErrorWithVoidFuture)
     EXPECT_EQ(99, calledWithInt);
 }
 
+TEST_F(CoreTest, smallErrorDoesNotAllocate)
+{
+    Promise<int> p1;
+    Promise<void> p2;
+    Future<int> f1 = p1.future();
+    Future<void> f2 = p2.future();
+
+    AllocationCounter counter;
+    p1.setError(42);
+    p2.setError(Timeout{});
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_TRUE(f1.isReady());
+    EXPECT_TRUE(f2.isReady());
+}
+
+TEST_F(CoreTest, typedErrorsOverloadedHandler)
+{
+    struct Handler
+    {
+        double operator()(int error) const
+        {
+            return error;
+        }
+
+        double operator()(const std::string &error) const
+        {
+            return static_cast<double>(error.size());
+        }
+    };
+
+    Promise<double, int, std::string> p1;
+    Promise<double, int, std::string> p2;
+    auto f1 = p1.future().onError(Handler{});
+    auto f2 = p2.future().onError(Handler{});
+
+    p1.setError(42);
+    p2.setError(std::string("hello"));
+    EXPECT_EQ(2u, processAll());
+    ASSERT_TRUE(f1.isReady());
+    ASSERT_TRUE(f2.isReady());
+    EXPECT_DOUBLE_EQ(42.0, f1.value());
+    EXPECT_DOUBLE_EQ(5.0, f2.value());
+}
+
+TEST_F(CoreTest, typedErrorsGenericHandler)
+{
+    Promise<void, int, long> p;
+    Future<void, int, long> f = p.future();
+
+    int calledWith = 0;
+    Future<void> g = f.onError([&](const auto &error)
+    {
+        calledWith = static_cast<int>(error);
+    });
+
+    p.setError(42L);
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_TRUE(g.isReady());
+    EXPECT_EQ(42, calledWith);
+}
+
+TEST_F(CoreTest, typedErrorsPartialHandler)
+{
+    Promise<int, int, std::string> p;
+    Future<int, int, std::string> f = p.future();
+
+    std::string calledWith;
+    Future<int, std::string> h = f.onError([&](int error)
+    {
+        return error;
+    });
+    Future<int> g = h.then([](int value)
+    {
+        return value;
+    });
+    g.onError([&](const std::string &error)
+    {
+        calledWith = error;
+        return 0;
+    });
+
+    p.setError(std::string("hello"));
+    processAll();
+    EXPECT_TRUE(g.isReady());
+    EXPECT_EQ("hello", calledWith);
+}
+
+TEST_F(CoreTest, typedErrorsChainedHandlers)
+{
+    Promise<int, int, std::string> p;
+    Future<int, int, std::string> f = p.future();
+
+    /* The error is kept until the handlers are specified. */
+    p.setError(std::string("hello"));
+    EXPECT_TRUE(f.isReady());
+
+    int cntIntErrors = 0;
+    Future<int> g = f.onError([&](int error)
+    {
+        cntIntErrors++;
+        return error;
+    }).onError([](const std::string &error)
+    {
+        return static_cast<int>(error.size());
+    });
+
+    processAll();
+    ASSERT_TRUE(g.isReady());
+    EXPECT_EQ(5, g.value());
+    EXPECT_EQ(0, cntIntErrors);
+}
+
+TEST_F(CoreTest, typedErrorsHandlerPassesValue)
+{
+    Promise<Counted, int> p;
+    Future<Counted> f = p.future().onError([](int error)
+    {
+        return Counted(error);
+    });
+
+    Counted::s_cntCopies = 0;
+    p.setValue(Counted(42));
+    processAll();
+    ASSERT_TRUE(f.isReady());
+    EXPECT_EQ(42, f.value().value());
+    EXPECT_EQ(0, Counted::s_cntCopies);
+}
+
+TEST_F(CoreTest, typedErrorsHandlerPassesBrokenPromise)
+{
+    Future<int> g = []()
+    {
+        Promise<int, int> p;
+        return p.future().onError([](int error)
+        {
+            return error;
+        });
+    }();
+
+    bool isBroken = false;
+    g.onError([&](const detail::BrokenPromise &)
+    {
+        isBroken = true;
+        return 0;
+    });
+
+    processAll();
+    EXPECT_TRUE(isBroken);
+}
+
+TEST_F(CoreTest, typedErrorHandlerDoesNotAllocate)
+{
+    struct Handler
+    {
+        int operator()(int error) const
+        {
+            return error;
+        }
+    };
+
+    Promise<int, int, std::string> p;
+    auto f = p.future();
+    ContextPool::reserve(sizeof(detail::ErrorSetHandlerContext<int, Handler, int, std::string>), 1);
+
+    /* The handler is kept by its context, which comes from the context pool. */
+    AllocationCounter counter;
+    Future<int, std::string> g = f.onError(Handler{});
+    EXPECT_EQ(0u, counter.count());
+
+    p.setError(42);
+    processAll();
+    ASSERT_TRUE(g.isReady());
+    EXPECT_EQ(42, g.value());
+}
+
 TEST_F(CoreTest, setErrorBeforeOnError)
 {
     Promise<int> p;
@@ -343,6 +550,150 @@ TEST_F(CoreTest, messageWithFutureChain)
     EXPECT_EQ(42, calledWithInt);
 }
 
+TEST_F(CoreTest, messageFollowsAsyncContinuation)
+{
+    Promise<int> p1;
+    Promise<int> p2;
+
+    int cntFirst = 0;
+    int cntSecond = 0;
+    p1.onMessage([&](int) { cntFirst++; });
+    p2.onMessage([&](int) { cntSecond++; });
+
+    auto f1 = p1.future().then([&](int)
+    {
+        return p2.future();
+    });
+    auto f2 = f1.then([](int value)
+    {
+        return value;
+    });
+
+    f2.sendMessage(1);
+    EXPECT_SMTH_INVOKED();
+    EXPECT_EQ(1, cntFirst);
+
+    p1.setValue(1);
+    EXPECT_FUTURE_FULFILLED();
+    f2.sendMessage(2);
+    f2.sendMessage(3);
+    EXPECT_MANY_INVOKED(2);
+    EXPECT_EQ(1, cntFirst);
+    EXPECT_EQ(2, cntSecond);
+
+    p2.setValue(2);
+    processAll();
+    f2.sendMessage(4);
+    EXPECT_NOTHING_INVOKED();
+}
+
+TEST_F(CoreTest, latestMessageIsCoalesced)
+{
+    Promise<int> p;
+    Future<int> f = p.future();
+
+    std::vector<int> received;
+    p.onLatestMessage([&](int priority)
+    {
+        received.push_back(priority);
+    });
+
+    f.sendMessage(1);
+    f.sendMessage(2);
+    f.sendMessage(3);
+    EXPECT_SMTH_INVOKED();
+    f.sendMessage(4);
+    EXPECT_SMTH_INVOKED();
+    EXPECT_EQ((std::vector<int>{3, 4}), received);
+}
+
+TEST_F(CoreTest, progressIsCoalesced)
+{
+    Promise<int> p;
+    Future<int> f = p.future();
+
+    std::vector<int> received;
+    f.onProgress([&](int percent)
+    {
+        received.push_back(percent);
+    });
+
+    p.reportProgress(10);
+    {
+        /* The consumer has not taken the progress yet. */
+        AllocationCounter counter;
+        p.reportProgress(20);
+        p.reportProgress(30);
+        EXPECT_EQ(0u, counter.count());
+    }
+    EXPECT_SMTH_INVOKED();
+    p.reportProgress(40);
+    EXPECT_SMTH_INVOKED();
+    EXPECT_EQ((std::vector<int>{30, 40}), received);
+}
+
+TEST_F(CoreTest, progressReachesContinuation)
+{
+    Promise<int> p;
+    auto f = p.future().then([](int value)
+    {
+        return value + 1;
+    });
+
+    double progress = 0.0;
+    std::string note;
+    f.onProgress([&](double value) { progress = value; });
+    f.onProgress([&](const std::string &value) { note = value; });
+
+    p.reportProgress(0.5);
+    p.reportProgress(std::string("halfway"));
+    EXPECT_EQ(2u, processAll());
+    EXPECT_DOUBLE_EQ(0.5, progress);
+    EXPECT_EQ("halfway", note);
+
+    p.setValue(1);
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_EQ(2, f.value());
+}
+
+TEST_F(CoreTest, batchScopeDefersFulfilment)
+{
+    ProfutVector<int> v(3);
+    std::vector<Future<int>> fs;
+    for ( auto &f : v.f ) {
+        fs.push_back(f.then([](int value) { return value * 2; }));
+    }
+
+    {
+        BatchScope outer;
+        {
+            BatchScope inner;
+            v.p[0].setValue(1);
+            v.p[1].setValue(2);
+        }
+        v.p[2].setValue(3);
+        EXPECT_NOTHING_INVOKED();
+    }
+    EXPECT_EQ(3u, processAll());
+    EXPECT_EQ(2, fs[0].value());
+    EXPECT_EQ(4, fs[1].value());
+    EXPECT_EQ(6, fs[2].value());
+}
+
+TEST_F(CoreTest, invokeBatch)
+{
+    int sum = 0;
+    std::array<safl::Executor::Task, 3> tasks{{
+        [&]() { sum += 1; },
+        [&]() { sum += 2; },
+        [&]() { sum += 3; }
+    }};
+
+    safl::Executor::instance()->invokeBatch(tasks.data(), tasks.size());
+    EXPECT_EQ(3u, processAll());
+    EXPECT_EQ(6, sum);
+}
+
 TEST_F(CoreTest, collectEmpty)
 {
     std::vector<Future<int>> fs;
@@ -447,6 +798,46 @@ TEST_F(CoreTest, collectError)
     EXPECT_TRUE(isError);
 }
 
+TEST_F(CoreTest, collectKeepsOrderOfInputs)
+{
+    constexpr std::size_t c_cntInputs = 100;
+    ProfutVector<int> v(c_cntInputs);
+
+    std::vector<int> result;
+    auto f = collect(v.f).then([&](std::vector<int> values)
+    {
+        result = std::move(values);
+    });
+
+    for ( std::size_t i = c_cntInputs; i > 0; i-- ) {
+        v.p[i - 1].setValue(static_cast<int>(i - 1));
+    }
+    processAll();
+
+    ASSERT_EQ(c_cntInputs, result.size());
+    for ( std::size_t i = 0; i < c_cntInputs; i++ ) {
+        EXPECT_EQ(static_cast<int>(i), result[i]);
+    }
+}
+
+TEST_F(CoreTest, collectErrorDropsValues)
+{
+    ProfutVector<MyInt> v(3);
+
+    bool isError = false;
+    auto f = collect(v.f).onError([&](int)
+    {
+        isError = true;
+        return std::vector<MyInt>();
+    });
+
+    v.p[0].setValue(MyInt(1));
+    v.p[2].setValue(MyInt(3));
+    v.p[1].setError(42);
+    processAll();
+    EXPECT_TRUE(isError);
+}
+
 TEST_F(CoreTest, collectMessage)
 {
     ProfutVector<int> v(2);
@@ -462,3 +853,450 @@ TEST_F(CoreTest, collectMessage)
     EXPECT_EQ(42, inMsg0);
     EXPECT_EQ(42, inMsg1);
 }
+
+TEST_F(CoreTest, collectSharesLargeMessage)
+{
+    using Message = std::array<int, 64>;
+    ProfutVector<int> v(3);
+
+    std::vector<const Message*> received;
+    for ( auto &p : v.p ) {
+        p.onMessage([&](const Message &msg) { received.push_back(&msg); });
+    }
+
+    auto f = collect(v.f);
+    Message msg{};
+    msg[0] = 42;
+    f.sendMessage(msg);
+    EXPECT_MANY_INVOKED(3);
+    ASSERT_EQ(3u, received.size());
+    EXPECT_EQ(received[0], received[1]);
+    EXPECT_EQ(received[0], received[2]);
+}
+
+TEST_F(CoreTest, collectTuple)
+{
+    Promise<int> p1;
+    Promise<void> p2;
+    Promise<std::string> p3;
+
+    auto f1 = p1.future();
+    auto f2 = p2.future();
+    auto f3 = p3.future();
+    std::tuple<int, std::string> result;
+    auto f = collect(f1, f2, f3)
+            .then([&](std::tuple<int, std::string> values)
+    {
+        result = std::move(values);
+    });
+
+    p3.setValue("three");
+    p1.setValue(1);
+    EXPECT_NO_FULFILLED_FUTURES();
+    p2.setValue();
+    processAll();
+
+    EXPECT_EQ(1, std::get<0>(result));
+    EXPECT_EQ("three", std::get<1>(result));
+}
+
+TEST_F(CoreTest, collectTupleMoveOnly)
+{
+    Promise<std::unique_ptr<int>> p1;
+    Promise<int> p2;
+    p1.setValue(std::unique_ptr<int>(new int(1)));
+
+    auto f1 = p1.future();
+    auto f2 = p2.future();
+    int result = 0;
+    auto f = collect(f1, f2)
+            .then([&](std::tuple<std::unique_ptr<int>, int> values)
+    {
+        result = *std::get<0>(values) + std::get<1>(values);
+    });
+
+    p2.setValue(2);
+    processAll();
+    EXPECT_EQ(3, result);
+}
+
+TEST_F(CoreTest, collectTupleDoesNotAllocate)
+{
+    Promise<int> p1;
+    Promise<void> p2;
+    Promise<double> p3;
+    auto f1 = p1.future();
+    auto f2 = p2.future();
+    auto f3 = p3.future();
+    ContextPool::reserve(sizeof(detail::TupleCollectContext<int, void, double>), 1);
+
+    AllocationCounter counter;
+    auto f = collect(f1, f2, f3);
+    p1.setValue(1);
+    p2.setValue();
+    p3.setValue(3.0);
+    /* The context comes from the context pool. */
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_TRUE(f.isReady());
+}
+
+TEST_F(CoreTest, collectTupleError)
+{
+    Promise<int> p1;
+    Promise<std::string> p2;
+
+    auto f1 = p1.future();
+    auto f2 = p2.future();
+    int error = 0;
+    auto f = collect(f1, f2).onError([&](int e)
+    {
+        error = e;
+        return std::tuple<int, std::string>();
+    });
+
+    p2.setValue("two");
+    p1.setError(42);
+    processAll();
+    EXPECT_EQ(42, error);
+}
+
+TEST_F(CoreTest, collectAnyTakesFirstValue)
+{
+    ProfutVector<int> v(3);
+
+    std::pair<std::size_t, int> result;
+    auto f = collectAny(v.f).then([&](std::pair<std::size_t, int> first)
+    {
+        result = first;
+    });
+
+    v.p[1].setError(1);
+    v.p[2].setValue(12);
+    v.p[0].setValue(10);
+    processAll();
+
+    EXPECT_EQ(2u, result.first);
+    EXPECT_EQ(12, result.second);
+}
+
+TEST_F(CoreTest, collectAnyStopsOthers)
+{
+    ProfutVector<int> v(3);
+
+    int cntStopped = 0;
+    for ( auto &p : v.p ) {
+        p.onMessage([&](int) { cntStopped++; });
+    }
+
+    std::size_t index = 3;
+    auto f = collectAny(v.f, 0).then([&](std::pair<std::size_t, int> first)
+    {
+        index = first.first;
+    });
+
+    v.p[0].setValue(10);
+    processAll();
+    EXPECT_EQ(0u, index);
+    EXPECT_EQ(2, cntStopped);
+
+    /* Detached inputs have no target any more. */
+    v.p[1].setValue(11);
+    v.p[2].setError(1);
+    EXPECT_NO_FULFILLED_FUTURES();
+}
+
+TEST_F(CoreTest, collectAnyFailsWhenAllFail)
+{
+    ProfutVector<void> v(2);
+
+    int error = 0;
+    auto f = collectAny(v.f).onError([&](int e)
+    {
+        error = e;
+        return std::size_t{0};
+    });
+
+    v.p[0].setError(1);
+    EXPECT_NO_FULFILLED_FUTURES();
+    v.p[1].setError(2);
+    processAll();
+    EXPECT_EQ(2, error);
+}
+
+TEST_F(CoreTest, collectNTakesFirstValues)
+{
+    ProfutVector<void> v(4);
+
+    std::vector<std::size_t> result;
+    auto f = collectN(v.f, 2).then([&](std::vector<std::size_t> indices)
+    {
+        result = std::move(indices);
+    });
+
+    v.p[3].setValue();
+    v.p[0].setError(1);
+    v.p[1].setValue();
+    v.p[2].setValue();
+    processAll();
+
+    EXPECT_EQ((std::vector<std::size_t>{3, 1}), result);
+}
+
+TEST_F(CoreTest, fulfilmentDoesNotAllocate)
+{
+    Promise<int> p;
+    auto f = p.future();
+
+    int calledWith = 0;
+    auto f3 = f.then([](int value)
+    {
+        return value + 1;
+    }).then([](int value)
+    {
+        return value * 2;
+    }).then([&](int value)
+    {
+        calledWith = value;
+    });
+
+    AllocationCounter counter;
+    p.setValue(20);
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_EQ(42, calledWith);
+    EXPECT_EQ(0u, counter.count());
+}
+
+TEST_F(CoreTest, inlineContinuation)
+{
+    Promise<int> p;
+    auto f = p.future();
+
+    int calledWith = 0;
+    auto f2 = f.then(ContinuationPolicy::Inline, [](int value)
+    {
+        return value * 2;
+    }).then([&](int value)
+    {
+        calledWith = value;
+    });
+
+    p.setValue(21);
+    EXPECT_EQ(0, calledWith);
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_EQ(42, calledWith);
+    EXPECT_NO_FULFILLED_FUTURES();
+}
+
+TEST_F(CoreTest, inlineExecutorPolicy)
+{
+    safl::Executor::instance()->setContinuationPolicy(ContinuationPolicy::Inline);
+
+    Promise<int> p;
+    int calledWith = 0;
+    auto f = p.future().then([](int value)
+    {
+        return value + 1;
+    }).then(ContinuationPolicy::Post, [](int value)
+    {
+        return value * 2;
+    }).then([&](int value)
+    {
+        calledWith = value;
+    });
+
+    p.setValue(20);
+    EXPECT_EQ(0, calledWith);
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_EQ(42, calledWith);
+    EXPECT_NO_FULFILLED_FUTURES();
+
+    safl::Executor::instance()->setContinuationPolicy(ContinuationPolicy::Default);
+}
+
+TEST_F(CoreTest, inlineDepthIsBounded)
+{
+    constexpr std::size_t c_maxDepth = 4;
+    constexpr int c_cntStages = 10;
+
+    const std::size_t oldMaxDepth = safl::Executor::maxInlineDepth();
+    safl::Executor::setMaxInlineDepth(c_maxDepth);
+
+    Promise<int> p;
+    std::vector<Future<int>> chain;
+    chain.push_back(p.future());
+    for ( int i = 0; i < c_cntStages; i++ ) {
+        chain.push_back(chain.back().then(ContinuationPolicy::Inline, [](int value)
+        {
+            return value + 1;
+        }));
+    }
+
+    p.setValue(0);
+    EXPECT_FALSE(chain.back().isReady());
+    EXPECT_EQ(2u, processAll());
+    EXPECT_TRUE(chain.back().isReady());
+    EXPECT_EQ(c_cntStages, chain.back().value());
+
+    safl::Executor::setMaxInlineDepth(oldMaxDepth);
+}
+
+TEST_F(CoreTest, fusedStagesWithVoid)
+{
+    Promise<void> p;
+    int calledWith = 0;
+    auto f = p.future().then([]()
+    {
+        return 21;
+    }).then([&](int value)
+    {
+        calledWith = value;
+    }).then([&]()
+    {
+        return calledWith * 2;
+    });
+
+    p.setValue();
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_NO_FULFILLED_FUTURES();
+    ASSERT_TRUE(f.isReady());
+    EXPECT_EQ(42, f.value());
+}
+
+TEST_F(CoreTest, namedFuturesAreNotFused)
+{
+    Promise<int> p;
+    auto f1 = p.future().then([](int value)
+    {
+        return value + 1;
+    });
+    auto f2 = f1.then([](int value)
+    {
+        return value * 2;
+    });
+
+    p.setValue(20);
+    EXPECT_FUTURE_FULFILLED();
+    ASSERT_TRUE(f1.isReady());
+    EXPECT_EQ(21, f1.value());
+    EXPECT_FALSE(f2.isReady());
+
+    EXPECT_FUTURE_FULFILLED();
+    ASSERT_TRUE(f2.isReady());
+    EXPECT_EQ(42, f2.value());
+}
+
+TEST_F(CoreTest, errorSkipsFusedStages)
+{
+    Promise<int> p;
+    bool isStageCalled = false;
+    int calledWithError = 0;
+    auto f = p.future().then([&](int value)
+    {
+        isStageCalled = true;
+        return value + 1;
+    }).then([&](int value)
+    {
+        isStageCalled = true;
+        return value * 2;
+    }).onError([&](int error)
+    {
+        calledWithError = error;
+        return 0;
+    });
+
+    p.setError(42);
+    processAll();
+    EXPECT_FALSE(isStageCalled);
+    EXPECT_EQ(42, calledWithError);
+    EXPECT_TRUE(f.isReady());
+}
+
+TEST_F(CoreTest, moveOnlyValue)
+{
+    Promise<std::unique_ptr<int>> p;
+    auto f = p.future().then([](std::unique_ptr<int> value)
+    {
+        *value *= 2;
+        return value;
+    });
+    auto f2 = std::move(f).then(ContinuationPolicy::Post, [](std::unique_ptr<int> &&value)
+    {
+        return std::move(value);
+    });
+
+    p.setValue(std::make_unique<int>(21));
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_FUTURE_FULFILLED();
+    ASSERT_TRUE(f2.isReady());
+    std::unique_ptr<int> value = f2.takeValue();
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(42, *value);
+}
+
+TEST_F(CoreTest, collectMoveOnly)
+{
+    ProfutVector<std::unique_ptr<int>> v(2);
+    int sum = 0;
+    auto f = collect(v.f).then([&](std::vector<std::unique_ptr<int>> values)
+    {
+        sum = *values[0] + *values[1];
+    });
+
+    v.p[1].setValue(std::make_unique<int>(2));
+    v.p[0].setValue(std::make_unique<int>(40));
+    EXPECT_FUTURE_FULFILLED();
+    EXPECT_EQ(42, sum);
+}
+
+TEST_F(CoreTest, emplaceValue)
+{
+    Promise<std::pair<int, std::string>> p;
+    auto f = p.future();
+
+    p.emplaceValue(42, "hello");
+    ASSERT_TRUE(f.isReady());
+    EXPECT_EQ(42, f.value().first);
+    EXPECT_EQ("hello", f.value().second);
+}
+
+TEST_F(CoreTest, valuesAreMovedThroughChain)
+{
+    Counted::s_cntCopies = 0;
+
+    Promise<Counted> p;
+    auto f = p.future().then([](Counted value)
+    {
+        return Counted(value.value() + 1);
+    }).then(ContinuationPolicy::Post, [](Counted &&value)
+    {
+        return std::move(value);
+    }).via(*safl::Executor::instance()).then([](Counted value)
+    {
+        return value;
+    });
+
+    p.setValue(Counted(41));
+    processAll();
+    ASSERT_TRUE(f.isReady());
+    EXPECT_EQ(42, f.takeValue().value());
+    EXPECT_EQ(0, Counted::s_cntCopies);
+}
+
+TEST_F(CoreTest, observedValuesAreNotMoved)
+{
+    Counted::s_cntCopies = 0;
+
+    Promise<Counted> p;
+    auto f = p.future();
+    auto byRef = f.then([](const Counted &value)
+    {
+        return value.value();
+    });
+
+    p.setValue(Counted(42));
+    EXPECT_FUTURE_FULFILLED();
+    ASSERT_TRUE(byRef.isReady());
+    EXPECT_EQ(42, byRef.value());
+    EXPECT_EQ(42, f.value().value());
+    EXPECT_EQ(0, Counted::s_cntCopies);
+}
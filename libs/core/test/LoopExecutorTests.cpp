@@ -0,0 +1,286 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include <safl/LoopExecutor.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+class LoopExecutorTest
+        : public ::testing::Test
+{
+public:
+    LoopExecutorTest()
+        : m_oldExecutor(safl::Executor::instance())
+    {
+        safl::Executor::setInstance(&m_loop);
+    }
+
+    ~LoopExecutorTest()
+    {
+        m_loop.runUntilIdle();
+        safl::Executor::setInstance(m_oldExecutor);
+    }
+
+    LoopExecutor &loop() noexcept
+    {
+        return m_loop;
+    }
+
+    bool isReadable() const noexcept
+    {
+        pollfd pfd{m_loop.fd(), POLLIN, 0};
+        return ::poll(&pfd, 1, 0) == 1;
+    }
+
+private:
+    safl::Executor *m_oldExecutor;
+    LoopExecutor m_loop;
+};
+
+} // anonymous namespace
+
+TEST_F(LoopExecutorTest, runUntilIdle)
+{
+    int cntCalled = 0;
+    loop().invoke([&]()
+    {
+        cntCalled++;
+        loop().invoke([&]()
+        {
+            cntCalled++;
+        });
+    });
+
+    EXPECT_EQ(2u, loop().runUntilIdle());
+    EXPECT_EQ(2, cntCalled);
+    EXPECT_EQ(0u, loop().runUntilIdle());
+}
+
+TEST_F(LoopExecutorTest, futureChain)
+{
+    Promise<int> p;
+    int calledWith = 0;
+    auto f = p.future().then([](int value)
+    {
+        return value * 2;
+    }).then([&](int value)
+    {
+        calledWith = value;
+    });
+
+    p.setValue(21);
+    EXPECT_EQ(1u, loop().runUntilIdle());
+    EXPECT_EQ(42, calledWith);
+}
+
+TEST_F(LoopExecutorTest, fdIsReadableWhenTasksArePending)
+{
+    EXPECT_FALSE(isReadable());
+
+    loop().invoke([]() {});
+    EXPECT_TRUE(isReadable());
+
+    EXPECT_EQ(1u, loop().poll());
+    EXPECT_FALSE(isReadable());
+}
+
+TEST_F(LoopExecutorTest, pollIsBounded)
+{
+    constexpr std::size_t c_cntTasks = 1000;
+    std::size_t cntCalled = 0;
+    for ( std::size_t i = 0; i < c_cntTasks; i++ ) {
+        loop().invoke([&]()
+        {
+            cntCalled++;
+        });
+    }
+
+    std::size_t cntPolled = loop().poll();
+    EXPECT_LT(cntPolled, c_cntTasks);
+    EXPECT_TRUE(isReadable());
+
+    while ( isReadable() ) {
+        cntPolled += loop().poll();
+    }
+    EXPECT_EQ(c_cntTasks, cntPolled);
+    EXPECT_EQ(c_cntTasks, cntCalled);
+}
+
+TEST_F(LoopExecutorTest, runOneWaitsForTask)
+{
+    int calledWith = 0;
+    std::thread producer([&]()
+    {
+        loop().invoke([&]()
+        {
+            calledWith = 42;
+        });
+    });
+
+    EXPECT_EQ(1u, loop().runOne());
+    EXPECT_EQ(42, calledWith);
+    producer.join();
+}
+
+TEST_F(LoopExecutorTest, promisesFulfilledByWorkers)
+{
+    constexpr std::size_t c_cntWorkers = 8;
+    constexpr std::size_t c_cntPromises = 10000;
+
+    ProfutVector<int> v(c_cntPromises);
+    std::atomic<std::size_t> nextIndex{0};
+    std::size_t cntCalled = 0;
+
+    std::vector<Future<void>> tails;
+    for ( auto &f : v.f ) {
+        tails.push_back(f.then([&](int)
+        {
+            if ( ++cntCalled == c_cntPromises ) {
+                loop().stop();
+            }
+        }));
+    }
+
+    std::vector<std::thread> workers;
+    for ( std::size_t i = 0; i < c_cntWorkers; i++ ) {
+        workers.emplace_back([&]()
+        {
+            for ( auto idx = nextIndex++; idx < c_cntPromises; idx = nextIndex++ ) {
+                v.p[idx].setValue(static_cast<int>(idx));
+            }
+        });
+    }
+
+    EXPECT_EQ(c_cntPromises, loop().run());
+    EXPECT_EQ(c_cntPromises, cntCalled);
+
+    for ( auto &worker : workers ) {
+        worker.join();
+    }
+}
+
+TEST_F(LoopExecutorTest, continuationsStayInTheirThreadExecutors)
+{
+    constexpr std::size_t c_cntShards = 4;
+    constexpr int c_cntSteps = 100;
+
+    struct Shard
+    {
+        LoopExecutor loop;
+        std::thread::id threadId;
+        int cntForeign = 0;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    for ( std::size_t i = 0; i < c_cntShards; i++ ) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+
+    /* Each shard thread builds its own chain, which is fulfilled from the main
+     * thread. Every continuation must run in the thread which created it. */
+    ProfutVector<int> v(c_cntShards);
+    std::atomic<std::size_t> cntReady{0};
+    std::vector<std::thread> threads;
+    for ( std::size_t i = 0; i < c_cntShards; i++ ) {
+        threads.emplace_back([&, i]()
+        {
+            Shard &shard = *shards[i];
+            shard.threadId = std::this_thread::get_id();
+            safl::Executor::setThreadInstance(&shard.loop);
+
+            std::vector<Future<int>> chain;
+            chain.push_back(std::move(v.f[i]));
+            for ( int step = 0; step < c_cntSteps; step++ ) {
+                chain.push_back(chain.back().then([&](int value)
+                {
+                    if ( std::this_thread::get_id() != shard.threadId ) {
+                        shard.cntForeign++;
+                    }
+                    return value + 1;
+                }));
+            }
+            auto tail = chain.back().then([&](int)
+            {
+                shard.loop.stop();
+            });
+
+            cntReady++;
+            shard.loop.run();
+            safl::Executor::setThreadInstance(nullptr);
+        });
+    }
+
+    while ( cntReady.load() < c_cntShards ) {
+        std::this_thread::yield();
+    }
+    for ( std::size_t i = 0; i < c_cntShards; i++ ) {
+        v.p[i].setValue(0);
+    }
+    for ( auto &thread : threads ) {
+        thread.join();
+    }
+
+    for ( auto &shard : shards ) {
+        EXPECT_EQ(0, shard->cntForeign);
+    }
+    EXPECT_EQ(&loop(), safl::Executor::instance());
+}
+
+TEST_F(LoopExecutorTest, sleepFor)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto f = sleepFor(std::chrono::milliseconds(5)).then([&]()
+    {
+        loop().stop();
+    });
+
+    loop().run();
+    EXPECT_TRUE(f.isReady());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+}
+
+TEST_F(LoopExecutorTest, batchScopeOfManyExecutors)
+{
+    constexpr std::size_t c_cntLoops = 5;
+    std::array<LoopExecutor, c_cntLoops> loops;
+    ProfutVector<int> v(c_cntLoops);
+    std::vector<Future<int>> fs;
+    for ( std::size_t i = 0; i < c_cntLoops; i++ ) {
+        fs.push_back(v.f[i].then(loops[i], [](int value)
+        {
+            return value * 2;
+        }));
+    }
+
+    {
+        BatchScope scope;
+        for ( std::size_t i = 0; i < c_cntLoops; i++ ) {
+            v.p[i].setValue(static_cast<int>(i));
+        }
+        /* The scope has no room for the batch of the last executor, so its
+         * continuation is scheduled directly. */
+        EXPECT_EQ(0u, loops.front().runUntilIdle());
+        EXPECT_EQ(1u, loops.back().runUntilIdle());
+    }
+
+    for ( std::size_t i = 0; i + 1 < c_cntLoops; i++ ) {
+        EXPECT_EQ(1u, loops[i].runUntilIdle());
+    }
+    for ( std::size_t i = 0; i < c_cntLoops; i++ ) {
+        EXPECT_EQ(static_cast<int>(i * 2), fs[i].value());
+    }
+}
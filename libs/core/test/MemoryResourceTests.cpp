@@ -0,0 +1,117 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include <safl/MemoryResource.h>
+
+#include <string>
+
+#if SAFL_HAS_MEMORY_RESOURCE
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+/* Counts allocations and checks that everything is returned. */
+class CountingResource final
+        : public std::pmr::memory_resource
+{
+public:
+    ~CountingResource()
+    {
+        EXPECT_EQ(0u, m_cntLive);
+    }
+
+    std::size_t cntAllocations() const noexcept
+    {
+        return m_cntAllocations;
+    }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        m_cntAllocations++;
+        m_cntLive++;
+        return m_arena.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        m_cntLive--;
+        m_arena.deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    std::pmr::monotonic_buffer_resource m_arena;
+    std::size_t m_cntAllocations = 0;
+    std::size_t m_cntLive = 0;
+};
+
+class MemoryResourceTest
+        : public Test
+{
+};
+
+} // anonymous namespace
+
+TEST_F(MemoryResourceTest, chainLivesInResourceOfPromise)
+{
+    CountingResource resource;
+    int calledWith = 0;
+    {
+        Promise<int> p(&resource);
+        EXPECT_EQ(1u, resource.cntAllocations());
+
+        /* Continuations inherit the resource of their input. */
+        auto f = p.future().then([](int value)
+        {
+            return value * 2;
+        }).then([&](int value)
+        {
+            calledWith = value;
+        });
+        EXPECT_EQ(3u, resource.cntAllocations());
+
+        p.setValue(21);
+        EXPECT_FUTURE_FULFILLED();
+    }
+    EXPECT_EQ(42, calledWith);
+}
+
+TEST_F(MemoryResourceTest, scopeCoversPromisesCollectAndSignals)
+{
+    CountingResource resource;
+    {
+        MemoryResourceScope scope(&resource);
+        ProfutVector<int> v(2);
+        EXPECT_EQ(2u, resource.cntAllocations());
+
+        auto f = collect(v.f);
+        EXPECT_EQ(3u, resource.cntAllocations());
+
+        v.p[0].setValue(1);
+        /* Small errors are stored in place, large ones are allocated. */
+        v.p[1].setError(std::string("error"));
+        EXPECT_EQ(4u, resource.cntAllocations());
+        processAll();
+    }
+}
+
+TEST_F(MemoryResourceTest, scopeDoesNotAffectOtherAllocations)
+{
+    CountingResource resource;
+    {
+        MemoryResourceScope scope(&resource);
+    }
+    Promise<int> p;
+    EXPECT_EQ(0u, resource.cntAllocations());
+}
+
+#endif
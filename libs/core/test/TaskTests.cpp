@@ -0,0 +1,91 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include <safl/Executor.h>
+
+#include <array>
+
+using namespace safl::testing;
+using safl::detail::Task;
+
+TEST(TaskTest, smallCallableIsInline)
+{
+    int calledWith = 0;
+    int *ptr = &calledWith;
+    Task task([ptr]()
+    {
+        *ptr = 42;
+    });
+
+    EXPECT_TRUE(task.isInline());
+    task.invoke();
+    EXPECT_EQ(42, calledWith);
+}
+
+TEST(TaskTest, largeCallableIsOnHeap)
+{
+    std::array<int, 32> values{};
+    int sum = -1;
+    Task task([values, &sum]()
+    {
+        sum = 0;
+        for ( auto value : values ) {
+            sum += value;
+        }
+    });
+
+    EXPECT_FALSE(task.isInline());
+    task.invoke();
+    EXPECT_EQ(0, sum);
+}
+
+TEST(TaskTest, largeCallableIsMoved)
+{
+    std::array<int, 32> values{};
+    values[0] = 42;
+    int sum = 0;
+    Task task([values, &sum]()
+    {
+        sum = values[0];
+    });
+
+    Task moved(std::move(task));
+    EXPECT_FALSE(moved.isInline());
+    moved.invoke();
+    EXPECT_EQ(42, sum);
+}
+
+TEST(TaskTest, moveOnlyCapture)
+{
+    auto value = std::make_unique<MyInt>(76);
+    int calledWith = 0;
+    Task task([&calledWith, value = std::move(value)]()
+    {
+        calledWith = value->value();
+    });
+
+    Task moved(std::move(task));
+    EXPECT_TRUE(moved.isInline());
+    moved.invoke();
+    EXPECT_EQ(76, calledWith);
+}
+
+TEST(TaskTest, captureDestroyedOnce)
+{
+    auto value = std::make_shared<MyInt>(1);
+
+    {
+        Task task([value]() {});
+        EXPECT_EQ(2, value.use_count());
+
+        Task moved(std::move(task));
+        EXPECT_EQ(2, value.use_count());
+
+        task = std::move(moved);
+        EXPECT_EQ(2, value.use_count());
+    }
+
+    EXPECT_EQ(1, value.use_count());
+}
@@ -0,0 +1,234 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+#include <safl/Composition.h>
+#include <safl/ThreadPoolExecutor.h>
+#ifdef SAFL_HAS_LOOP_EXECUTOR
+#include <safl/LoopExecutor.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+class ThreadPoolTest
+        : public ::testing::Test
+{
+public:
+    ThreadPoolTest()
+        : m_oldExecutor(safl::Executor::instance())
+        , m_pool(std::make_unique<ThreadPoolExecutor>(4))
+    {
+        safl::Executor::setInstance(m_pool.get());
+    }
+
+    ~ThreadPoolTest()
+    {
+        /* Remaining tasks may still post continuations while being drained. */
+        m_pool.reset();
+        safl::Executor::setInstance(m_oldExecutor);
+    }
+
+    ThreadPoolExecutor &pool() noexcept
+    {
+        return *m_pool;
+    }
+
+private:
+    safl::Executor *m_oldExecutor;
+    std::unique_ptr<ThreadPoolExecutor> m_pool;
+};
+
+} // anonymous namespace
+
+TEST_F(ThreadPoolTest, runsTasks)
+{
+    constexpr int c_cntTasks = 10000;
+    std::atomic<int> cntDone{0};
+    std::promise<void> done;
+
+    for ( int i = 0; i < c_cntTasks; i++ ) {
+        pool().invoke([&]()
+        {
+            if ( ++cntDone == c_cntTasks ) {
+                done.set_value();
+            }
+        });
+    }
+
+    done.get_future().wait();
+    EXPECT_EQ(c_cntTasks, cntDone.load());
+}
+
+TEST_F(ThreadPoolTest, isInExecutorThread)
+{
+    std::promise<bool> inPool;
+    pool().invoke([&]()
+    {
+        inPool.set_value(pool().isInExecutorThread());
+    });
+
+    EXPECT_TRUE(inPool.get_future().get());
+    EXPECT_FALSE(pool().isInExecutorThread());
+}
+
+TEST_F(ThreadPoolTest, slotOfBlockedWorkerIsStolen)
+{
+    std::atomic<bool> isBlocked{false};
+    std::atomic<bool> isContinued{false};
+    std::promise<bool> result;
+
+    pool().invoke([&]()
+    {
+        /* The task goes to the LIFO slot of this worker, which then blocks
+         * until another worker runs it. */
+        pool().invoke([&]()
+        {
+            isContinued = true;
+        });
+        isBlocked = true;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while ( !isContinued && std::chrono::steady_clock::now() < deadline ) {
+            std::this_thread::yield();
+        }
+        result.set_value(isContinued.load());
+    });
+
+    /* Another task wakes up another worker, which then looks for more work. */
+    while ( !isBlocked ) {
+        std::this_thread::yield();
+    }
+    pool().invoke([]()
+    {
+    });
+    EXPECT_TRUE(result.get_future().get());
+}
+
+TEST_F(ThreadPoolTest, continuationChain)
+{
+    std::promise<int> result;
+    Promise<int> p;
+
+    std::vector<Future<int>> chain;
+    chain.push_back(p.future());
+    for ( int i = 0; i < 100; i++ ) {
+        chain.push_back(chain.back().then([](int value)
+        {
+            return value + 1;
+        }));
+    }
+    chain.back().then([&](int value)
+    {
+        result.set_value(value);
+    });
+
+    p.setValue(1000);
+    EXPECT_EQ(1100, result.get_future().get());
+}
+
+TEST_F(ThreadPoolTest, collectFanOut)
+{
+    constexpr std::size_t c_cntFutures = 1000;
+    ProfutVector<int> v(c_cntFutures);
+    std::vector<Future<int>> squares;
+    std::promise<long> result;
+
+    for ( auto &f : v.f ) {
+        squares.push_back(f.then([](int value)
+        {
+            return value * value;
+        }));
+    }
+    collect(squares).then([&](const std::vector<int> &values)
+    {
+        result.set_value(std::accumulate(values.begin(), values.end(), 0L));
+    });
+
+    for ( std::size_t i = 0; i < c_cntFutures; i++ ) {
+        pool().invoke([&v, i]()
+        {
+            v.p[i].setValue(static_cast<int>(i));
+        });
+    }
+
+    long expected = 0;
+    for ( long i = 0; i < static_cast<long>(c_cntFutures); i++ ) {
+        expected += i * i;
+    }
+    EXPECT_EQ(expected, result.get_future().get());
+}
+
+#ifdef SAFL_HAS_LOOP_EXECUTOR
+TEST_F(ThreadPoolTest, continuationsHopBetweenExecutors)
+{
+    /* The main thread plays the GUI thread, while heavy stages run in the
+     * pool. */
+    LoopExecutor gui;
+    safl::Executor::setThreadInstance(&gui);
+
+    std::vector<bool> inPool;
+    Promise<int> p;
+    auto f = p.future().then([&](int value)
+    {
+        inPool.push_back(pool().isInExecutorThread());
+        return value + 1;
+    }).then(pool(), [&](int value)
+    {
+        inPool.push_back(pool().isInExecutorThread());
+        return value * 2;
+    }).then([&](int value)
+    {
+        inPool.push_back(pool().isInExecutorThread());
+        return value + 1;
+    }).via(gui).then([&](int value)
+    {
+        inPool.push_back(pool().isInExecutorThread());
+        gui.stop();
+        return value;
+    });
+
+    p.setValue(1);
+    gui.run();
+
+    EXPECT_EQ(std::vector<bool>({false, true, true, false}), inPool);
+    EXPECT_EQ(5, f.value());
+    safl::Executor::setThreadInstance(nullptr);
+}
+
+TEST_F(ThreadPoolTest, errorHandlersRunInBoundExecutor)
+{
+    LoopExecutor gui;
+    safl::Executor::setThreadInstance(&gui);
+
+    bool isHandledInGui = false;
+    Promise<int> p;
+    auto f = p.future().then(pool(), [](int value)
+    {
+        return value;
+    }).via(gui).onError([&](int)
+    {
+        isHandledInGui = gui.isInExecutorThread() && !pool().isInExecutorThread();
+        gui.stop();
+        return 0;
+    });
+
+    pool().invoke([&]()
+    {
+        p.setError(42);
+    });
+    gui.run();
+
+    EXPECT_TRUE(isHandledInGui);
+    safl::Executor::setThreadInstance(nullptr);
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace safl;
+using namespace safl::testing;
+
+namespace {
+
+constexpr std::size_t c_cntWorkers = 8;
+constexpr std::size_t c_cntPromises = 20000;
+
+class ThreadingTest
+        : public Test
+{
+public:
+    /* Run tFunc(index) for every index in [0, cnt) spread among worker threads,
+     * while the test thread is doing its own job. */
+    template<typename tFunc, typename tJob>
+    void hammer(std::size_t cnt, tFunc &&f, tJob &&job)
+    {
+        std::atomic<std::size_t> nextIndex{0};
+        std::vector<std::thread> workers;
+        for ( std::size_t i = 0; i < c_cntWorkers; i++ ) {
+            workers.emplace_back([&]()
+            {
+                for ( auto idx = nextIndex++; idx < cnt; idx = nextIndex++ ) {
+                    f(idx);
+                }
+            });
+        }
+
+        job();
+
+        for ( auto &worker : workers ) {
+            worker.join();
+        }
+        processAll();
+    }
+};
+
+} // anonymous namespace
+
+TEST_F(ThreadingTest, setValueRacesWithThen)
+{
+    ProfutVector<int> v(c_cntPromises);
+    std::vector<int> results(c_cntPromises, -1);
+    std::vector<Future<void>> tails;
+
+    hammer(c_cntPromises, [&](std::size_t idx)
+    {
+        v.p[idx].setValue(static_cast<int>(idx));
+    }, [&]()
+    {
+        for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+            tails.push_back(v.f[i].then([&results, i](int value)
+            {
+                results[i] = value;
+            }));
+            if ( i % 64 == 0 ) {
+                processAll();
+            }
+        }
+    });
+
+    for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+        ASSERT_EQ(static_cast<int>(i), results[i]);
+        ASSERT_TRUE(tails[i].isReady());
+    }
+}
+
+TEST_F(ThreadingTest, setErrorRacesWithOnError)
+{
+    ProfutVector<int> v(c_cntPromises);
+    std::vector<int> results(c_cntPromises, -1);
+    std::vector<Future<int>> tails;
+
+    hammer(c_cntPromises, [&](std::size_t idx)
+    {
+        /* Promises are destroyed in worker threads as well. */
+        auto p = std::move(v.p[idx]);
+        if ( idx % 2 == 0 ) {
+            p.setError(std::string("error"));
+        } else {
+            p.setValue(static_cast<int>(idx));
+        }
+    }, [&]()
+    {
+        for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+            tails.push_back(v.f[i].then([](int value)
+            {
+                return value;
+            }).onError([i](const std::string &)
+            {
+                return static_cast<int>(i);
+            }));
+            if ( i % 64 == 0 ) {
+                processAll();
+            }
+        }
+    });
+
+    for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+        ASSERT_TRUE(tails[i].isReady());
+        ASSERT_EQ(static_cast<int>(i), tails[i].value());
+    }
+}
+
+TEST_F(ThreadingTest, brokenPromiseRacesWithFutureDestruction)
+{
+    ProfutVector<MyInt> v(c_cntPromises);
+    std::atomic<std::size_t> cntBroken{0};
+
+    hammer(c_cntPromises, [&](std::size_t idx)
+    {
+        auto p = std::move(v.p[idx]);
+        (void)p;
+    }, [&]()
+    {
+        for ( std::size_t i = 0; i < c_cntPromises; i++ ) {
+            if ( i % 2 == 0 ) {
+                /* Drop the future, so the context may be destroyed by either
+                 * of the threads. */
+                auto f = std::move(v.f[i]);
+                (void)f;
+            } else {
+                v.f[i].onError([&](BrokePromise)
+                {
+                    cntBroken++;
+                    return MyInt(0);
+                });
+            }
+        }
+    });
+
+    EXPECT_EQ(c_cntPromises / 2, cntBroken.load());
+}
@@ -0,0 +1,214 @@
+/*
+ * This file is a part of Stand-alone Future Library (safl).
+ */
+
+#include <safl/testing/Testing.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace safl;
+using namespace safl::testing;
+using namespace std::chrono_literals;
+
+namespace {
+
+class TimerTest
+        : public Test
+{
+};
+
+class SharedTimerTest
+        : public ::testing::Test
+{
+};
+
+/* Runs scheduled nodes right away, in the thread which schedules them. */
+class InlineExecutor final
+        : public safl::Executor
+{
+public:
+    void invoke(Task &&task) noexcept override
+    {
+        task.invoke();
+    }
+
+    void schedule(TaskNode *node) noexcept override
+    {
+        node->run();
+    }
+
+    bool isInExecutorThread() const noexcept override
+    {
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+TEST_F(TimerTest, sleepFor)
+{
+    bool isCalled = false;
+    auto f = sleepFor(10ms).then([&]()
+    {
+        isCalled = true;
+    });
+
+    advanceTime(9ms);
+    EXPECT_NOTHING_INVOKED();
+
+    advanceTime(1ms);
+    processAll();
+    EXPECT_TRUE(isCalled);
+}
+
+TEST_F(TimerTest, timersExpireInOrderOfDeadlines)
+{
+    std::vector<int> order;
+    std::vector<Future<void>> futures;
+    for ( int delay : {30, 10, 20, 10} ) {
+        futures.push_back(sleepFor(std::chrono::milliseconds(delay)).then([&order, delay]()
+        {
+            order.push_back(delay);
+        }));
+    }
+
+    advanceTime(1s);
+    processAll();
+    EXPECT_EQ((std::vector<int>{10, 10, 20, 30}), order);
+}
+
+TEST_F(TimerTest, droppedSleepStopsTimer)
+{
+    for ( int i = 0; i < 1000; i++ ) {
+        sleepFor(1ms);
+    }
+
+    bool isCalled = false;
+    auto f = sleepFor(2ms).then([&]()
+    {
+        isCalled = true;
+    });
+
+    advanceTime(2ms);
+    EXPECT_EQ(2u, processAll());
+    EXPECT_TRUE(isCalled);
+}
+
+TEST_F(TimerTest, withinPassesValue)
+{
+    Promise<std::string> p;
+
+    std::string result;
+    auto f = p.future().within(10ms).then([&](std::string value)
+    {
+        result = std::move(value);
+    });
+
+    p.setValue("value");
+    processAll();
+    EXPECT_EQ("value", result);
+
+    advanceTime(10ms);
+    EXPECT_NOTHING_INVOKED();
+}
+
+TEST_F(TimerTest, withinPassesError)
+{
+    Promise<void> p;
+
+    int error = 0;
+    auto f = p.future().within(10ms).onError([&](int e)
+    {
+        error = e;
+    });
+
+    p.setError(42);
+    processAll();
+    EXPECT_EQ(42, error);
+
+    advanceTime(10ms);
+    EXPECT_NOTHING_INVOKED();
+}
+
+TEST_F(TimerTest, withinTimesOut)
+{
+    Promise<int> p;
+
+    bool isTimedOut = false;
+    auto f = p.future().within(10ms).onError([&](Timeout)
+    {
+        isTimedOut = true;
+        return 0;
+    });
+
+    advanceTime(10ms);
+    processAll();
+    EXPECT_TRUE(isTimedOut);
+    EXPECT_TRUE(p.isCancelled());
+
+    p.setValue(1);
+    EXPECT_NOTHING_INVOKED();
+}
+
+TEST_F(TimerTest, withinKeepsNamedFuture)
+{
+    Promise<int> p;
+    auto f = p.future();
+
+    bool isTimedOut = false;
+    auto g = f.within(10ms).onError([&](Timeout)
+    {
+        isTimedOut = true;
+        return 0;
+    });
+
+    advanceTime(10ms);
+    processAll();
+    EXPECT_TRUE(isTimedOut);
+    EXPECT_FALSE(p.isCancelled());
+
+    p.setValue(1);
+    EXPECT_TRUE(f.isReady());
+}
+
+TEST_F(SharedTimerTest, expiredTimerStartsTimer)
+{
+    InlineExecutor executor;
+    std::promise<void> started;
+    std::promise<void> expired;
+    detail::TimerHandle second;
+
+    auto first = detail::startTimer(&executor, 1ms, [&]()
+    {
+        /* This runs in the timer thread, as the executor runs tasks right away. */
+        second = detail::startTimer(&executor, 1ms, [&]()
+        {
+            expired.set_value();
+        });
+        started.set_value();
+    });
+
+    EXPECT_EQ(std::future_status::ready, started.get_future().wait_for(5s));
+    EXPECT_EQ(std::future_status::ready, expired.get_future().wait_for(5s));
+}
+
+TEST_F(SharedTimerTest, destroyedExecutorDropsTimers)
+{
+    std::atomic<bool> isExpired{false};
+    detail::TimerHandle handle;
+    {
+        InlineExecutor executor;
+        handle = detail::startTimer(&executor, 1ms, [&]()
+        {
+            isExpired = true;
+        });
+    }
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(isExpired);
+}
@@ -75,3 +75,17 @@ TEST(FunctionTraitsTest, sanityCheck)
     CHECK_TRAIT_RVALUE(&MyTraitClass::func);
     CHECK_TRAIT_RVALUE(&MyTraitClass::constFunc);
 }
+
+TEST(FunctionTraitsTest, isCallableWith)
+{
+    using safl::detail::IsCallableWith;
+
+    auto byValue = [](std::unique_ptr<int>) {};
+    auto byRvalue = [](std::unique_ptr<int> &&) {};
+    auto byConstRef = [](const std::unique_ptr<int> &) {};
+
+    EXPECT_FALSE((IsCallableWith<decltype(byValue), const std::unique_ptr<int>&>::value));
+    EXPECT_TRUE((IsCallableWith<decltype(byValue), std::unique_ptr<int>>::value));
+    EXPECT_FALSE((IsCallableWith<decltype(byRvalue), const std::unique_ptr<int>&>::value));
+    EXPECT_TRUE((IsCallableWith<decltype(byConstRef), const std::unique_ptr<int>&>::value));
+}
@@ -12,6 +12,9 @@ class Executor;
 
 namespace qt {
 
+/**
+ * @brief Make the Qt event loop the executor of the calling thread.
+ */
 class ExecutorScope
         : private detail::UniqueInstance
 {
@@ -5,72 +5,215 @@
 #include <safl/qt/Executor.h>
 
 #include <safl/Executor.h>
+#include <safl/detail/ConcurrentTaskQueue.h>
+#include <safl/detail/Timer.h>
 
 #include <QObject>
 #include <QEvent>
 #include <QCoreApplication>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
 
 using namespace safl::qt;
 
 namespace {
 
 using safl::Executor;
+using safl::detail::ConcurrentTaskQueue;
 using safl::detail::Task;
+using safl::detail::TaskBox;
+using safl::detail::TaskNode;
+using safl::detail::TaskQueue;
+using safl::detail::TimerNode;
+using safl::detail::TimerQueue;
+
+/* The maximum number of tasks run by a single event, so events of the user
+ * interface are not starved by a flood of tasks. */
+constexpr std::size_t c_maxEventBatch = 256;
 
+/* The event which makes the executor run its queued tasks. */
 class SaflEvent final
         : public QEvent
 {
 public:
-    static QEvent::Type s_eventType;
-
-public:
-    SaflEvent(Task &&f)
-        : QEvent(s_eventType)
-        , f(std::move(f))
+    SaflEvent()
+        : QEvent(eventType())
     {
     }
 
-    Task f;
+    /* The type is shared by the executors of all threads, so it is registered
+     * once. */
+    static QEvent::Type eventType() noexcept
+    {
+        static const QEvent::Type s_type =
+                static_cast<QEvent::Type>(QEvent::registerEventType());
+        return s_type;
+    }
 };
 
-QEvent::Type SaflEvent::s_eventType;
-
 class QtExecutor final
         : public QObject
         , public Executor
 {
 public:
-    QtExecutor() noexcept
+private:
+    void invoke(Task &&f) noexcept override
     {
-        SaflEvent::s_eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+        schedule(new TaskBox(std::move(f)));
     }
 
-private:
-    void invoke(Task &&f) noexcept override
+    /* Tasks are queued by the executor itself, so posting one takes neither
+     * a lock nor an allocation, and a single event is posted for all tasks
+     * which are queued until it is handled. */
+    void schedule(TaskNode *node) noexcept override
+    {
+        m_queue.push(node);
+        wake();
+    }
+
+    void invokeBatch(Task *tasks, std::size_t cnt) noexcept override
     {
-        QCoreApplication::postEvent(this, new SaflEvent(std::move(f)));
+        TaskQueue nodes;
+        for ( std::size_t i = 0; i < cnt; i++ ) {
+            nodes.push(new TaskBox(std::move(tasks[i])));
+        }
+        scheduleBatch(nodes);
+    }
+
+    void scheduleBatch(TaskQueue &nodes) noexcept override
+    {
+        if ( nodes.isEmpty() ) {
+            return;
+        }
+        while ( TaskNode *node = nodes.pop() ) {
+            m_queue.push(node);
+        }
+        wake();
+    }
+
+    void wake() noexcept
+    {
+        if ( !m_isPosted.load(std::memory_order_seq_cst) &&
+             !m_isPosted.exchange(true, std::memory_order_seq_cst) ) {
+            QCoreApplication::postEvent(this, new SaflEvent());
+        }
+    }
+
+    bool isInExecutorThread() const noexcept override
+    {
+        return QThread::currentThread() == thread();
+    }
+
+    /* All timers share a single Qt timer, which is armed for the first one. */
+    void startTimer(TimerNode *timer) noexcept override
+    {
+        std::unique_lock<std::mutex> lock(m_timersMutex);
+        const bool isFirst = m_timers.push(timer);
+        lock.unlock();
+
+        if ( isFirst ) {
+            /* The Qt timer may be used only in the thread of the executor. */
+            if ( isInExecutorThread() ) {
+                rearmTimer();
+            } else {
+                invoke([this]() { rearmTimer(); });
+            }
+        }
+    }
+
+    void rearmTimer()
+    {
+        std::lock_guard<std::mutex> lock(m_timersMutex);
+        if ( m_timerId != 0 ) {
+            killTimer(m_timerId);
+            m_timerId = 0;
+        }
+
+        if ( !m_timers.isEmpty() ) {
+            using namespace std::chrono;
+            const auto delay = duration_cast<milliseconds>(
+                    m_timers.nextDeadline() - Clock::now() + milliseconds(1) - nanoseconds(1));
+            const auto ms = std::max<milliseconds::rep>(delay.count(), 0);
+            m_timerId = QObject::startTimer(static_cast<int>(ms), Qt::PreciseTimer);
+        }
+    }
+
+    void timerEvent(QTimerEvent *event) override
+    {
+        if ( event->timerId() != m_timerId ) {
+            return;
+        }
+
+        /* Expired timers schedule themselves, and a task run meanwhile may
+         * start a timer, so they are expired without the lock. */
+        std::vector<TimerNode*> expired;
+        std::unique_lock<std::mutex> lock(m_timersMutex);
+        const Clock::time_point now = Clock::now();
+        while ( TimerNode *timer = m_timers.popDue(now) ) {
+            expired.push_back(timer);
+        }
+        lock.unlock();
+
+        for ( auto *timer : expired ) {
+            timer->expire();
+        }
+        rearmTimer();
     }
 
     void customEvent(QEvent *event) override
     {
-        if ( event->type() == SaflEvent::s_eventType ) {
-            auto *se = static_cast<SaflEvent*>(event);
-            se->f.invoke();
-            se->accept();
+        if ( event->type() != SaflEvent::eventType() ) {
+            return;
+        }
+        event->accept();
+
+        /* The event is consumed first, so tasks queued meanwhile post another
+         * one. */
+        m_isPosted.store(false, std::memory_order_seq_cst);
+
+        std::size_t cnt = 0;
+        while ( cnt < c_maxEventBatch ) {
+            TaskNode *node = m_queue.pop();
+            if ( node == nullptr ) {
+                break;
+            }
+            node->run();
+            cnt++;
+        }
+
+        /* The rest runs with the next event, after pending events of the user
+         * interface. */
+        if ( !m_queue.isEmpty() ) {
+            wake();
         }
     }
+
+private:
+    ConcurrentTaskQueue m_queue;
+    std::atomic<bool> m_isPosted{false};
+
+    std::mutex m_timersMutex;
+    TimerQueue m_timers;
+    int m_timerId = 0;
 };
 
 } // anonymous namespace
 
 ExecutorScope::ExecutorScope() noexcept
 {
-    static QtExecutor s_qtExecutor;
-    m_oldExecutor = Executor::instance();
-    Executor::setInstance(&s_qtExecutor);
+    /* Each thread with an event loop gets its own executor, which lives in
+     * that thread. Other threads keep their executors. */
+    static thread_local QtExecutor t_qtExecutor;
+    m_oldExecutor = Executor::threadInstance();
+    Executor::setThreadInstance(&t_qtExecutor);
 }
 
 ExecutorScope::~ExecutorScope()
 {
-    Executor::setInstance(m_oldExecutor);
+    Executor::setThreadInstance(m_oldExecutor);
 }
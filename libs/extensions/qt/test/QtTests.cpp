@@ -11,8 +11,12 @@
 #include <safl/Composition.h>
 
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QTimer>
 
+#include <atomic>
+#include <thread>
+
 using namespace safl;
 using namespace safl::testing;
 
@@ -66,6 +70,83 @@ TEST_F(QtTest, executor)
     EXPECT_EQ(99, rv);
 }
 
+TEST_F(QtTest, manyTasksRunInBatches)
+{
+    /* More tasks than a single event runs. */
+    ProfutVector<int> v(1000);
+    int sum = 0;
+    std::vector<Future<void>> futures;
+    for ( auto &f : v.f ) {
+        futures.push_back(f.then([&](int i) { sum += i; }));
+    }
+
+    safl::collect(futures).then([&]()
+    {
+        qApp->exit(sum);
+    });
+
+    int rv = inloop([&]()
+    {
+        for ( auto &p : v.p ) {
+            p.setValue(1);
+        }
+    });
+
+    EXPECT_EQ(1000, rv);
+}
+
+TEST_F(QtTest, executorsOfConcurrentThreads)
+{
+    /* The first thread posts its tasks before the second one gets its
+     * executor, and each runs more tasks than a single event does. */
+    constexpr int c_cntTasks = 1000;
+    std::atomic<int> cntReady{0};
+
+    auto run = [&](int order)
+    {
+        while ( cntReady.load() != order ) {
+            std::this_thread::yield();
+        }
+
+        QEventLoop loop;
+        safl::qt::ExecutorScope scope;
+        ProfutVector<int> v(c_cntTasks);
+        int sum = 0;
+        std::vector<Future<void>> futures;
+        for ( auto &f : v.f ) {
+            futures.push_back(f.then([&](int i) { sum += i; }));
+        }
+        auto f = safl::collect(futures).then([&]()
+        {
+            loop.exit(sum);
+        });
+        for ( auto &p : v.p ) {
+            p.setValue(1);
+        }
+
+        cntReady++;
+        while ( cntReady.load() != 2 ) {
+            std::this_thread::yield();
+        }
+
+        QTimer::singleShot(5000, [&]()
+        {
+            loop.exit(-1);
+        });
+        return loop.exec();
+    };
+
+    int rv1 = 0;
+    int rv2 = 0;
+    std::thread t1([&]() { rv1 = run(0); });
+    std::thread t2([&]() { rv2 = run(1); });
+    t1.join();
+    t2.join();
+
+    EXPECT_EQ(c_cntTasks, rv1);
+    EXPECT_EQ(c_cntTasks, rv2);
+}
+
 TEST_F(QtTest, signal0)
 {
     MyObject object;
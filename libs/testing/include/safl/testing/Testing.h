@@ -93,8 +93,17 @@ public:
 
     bool processSingle() noexcept;
     bool processMultiple(std::size_t cnt) noexcept;
+    std::size_t processAll() noexcept;
     std::size_t queueSize() noexcept;
 
+    /**
+     * @brief Advance the virtual time of the executor.
+     *
+     * Timers which expire meanwhile are queued in the order of their
+     * deadlines, so they run with the next process*() call.
+     */
+    void advanceTime(safl::Executor::Clock::duration duration) noexcept;
+
 private:
     std::unique_ptr<Executor> m_executor;
 };
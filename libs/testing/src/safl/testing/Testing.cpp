@@ -8,9 +8,11 @@
 // Safl includes:
 #include <safl/Executor.h>
 #include <safl/detail/DebugContext.h>
+#include <safl/detail/Timer.h>
 
 // Std includes:
-#include <queue>
+#include <mutex>
+#include <thread>
 
 namespace safl {
 namespace testing {
@@ -19,13 +21,29 @@ class Executor final
         : public safl::Executor
 {
 public:
+    Executor() noexcept;
     void invoke(Task &&task) noexcept override;
+    void schedule(TaskNode *node) noexcept override;
+    void invokeBatch(Task *tasks, std::size_t cnt) noexcept override;
+    void scheduleBatch(safl::detail::TaskQueue &nodes) noexcept override;
+    bool isInExecutorThread() const noexcept override;
+    Clock::time_point now() const noexcept override;
+    void startTimer(safl::detail::TimerNode *timer) noexcept override;
     bool processSingle();
     void processNext();
     std::size_t queueSize() const;
+    void advanceTime(Clock::duration duration);
+    void clearTimers() noexcept;
 
 private:
-    std::queue<Task> m_queue;
+    /* Tasks can be posted from other threads by multi-threaded tests. */
+    mutable std::mutex m_mutex;
+    safl::detail::TaskQueue m_queue;
+    const std::thread::id m_threadId;
+
+    /* The time is virtual, so timers expire only when a test advances it. */
+    safl::detail::TimerQueue m_timers;
+    Clock::time_point m_now;
 };
 
 } // namespace testing
@@ -36,14 +54,81 @@ using namespace safl::testing;
 
 using TestExecutor = safl::testing::Executor;
 
+TestExecutor::Executor() noexcept
+    : m_threadId(std::this_thread::get_id())
+{
+}
+
 void TestExecutor::invoke(Task &&task) noexcept
 {
-    m_queue.push(std::move(task));
+    schedule(new safl::detail::TaskBox(std::move(task)));
+}
+
+void TestExecutor::schedule(TaskNode *node) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push(node);
+}
+
+void TestExecutor::invokeBatch(Task *tasks, std::size_t cnt) noexcept
+{
+    safl::detail::TaskQueue nodes;
+    for ( std::size_t i = 0; i < cnt; i++ ) {
+        nodes.push(new safl::detail::TaskBox(std::move(tasks[i])));
+    }
+    scheduleBatch(nodes);
+}
+
+void TestExecutor::scheduleBatch(safl::detail::TaskQueue &nodes) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while ( TaskNode *node = nodes.pop() ) {
+        m_queue.push(node);
+    }
+}
+
+bool TestExecutor::isInExecutorThread() const noexcept
+{
+    return std::this_thread::get_id() == m_threadId;
+}
+
+TestExecutor::Clock::time_point TestExecutor::now() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_now;
+}
+
+void TestExecutor::startTimer(safl::detail::TimerNode *timer) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timers.push(timer);
+}
+
+void TestExecutor::advanceTime(Clock::duration duration)
+{
+    /* Expired timers schedule themselves, which takes the lock. */
+    std::vector<safl::detail::TimerNode*> expired;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_now += duration;
+    while ( auto *timer = m_timers.popDue(m_now) ) {
+        expired.push_back(timer);
+    }
+    lock.unlock();
+
+    for ( auto *timer : expired ) {
+        timer->expire();
+    }
+}
+
+void TestExecutor::clearTimers() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timers.clear();
 }
 
 bool TestExecutor::processSingle()
 {
-    if ( m_queue.size() != 1 ) {
+    if ( queueSize() != 1 ) {
         return false;
     }
 
@@ -53,13 +138,15 @@ bool TestExecutor::processSingle()
 
 void TestExecutor::processNext()
 {
-    auto f = std::move(m_queue.front());
-    m_queue.pop();
-    f.invoke();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    TaskNode *node = m_queue.pop();
+    lock.unlock();
+    node->run();
 }
 
 std::size_t TestExecutor::queueSize() const
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_queue.size();
 }
 
@@ -73,6 +160,7 @@ Test::Test() noexcept
 Test::~Test() noexcept
 {
     EXPECT_NOTHING_INVOKED();
+    m_executor->clearTimers();
 
 #ifdef SAFL_DEVELOPER
     /* Simple test for memory leaks. */
@@ -99,6 +187,21 @@ bool Test::processMultiple(std::size_t cnt) noexcept
     return true;
 }
 
+std::size_t Test::processAll() noexcept
+{
+    std::size_t cnt = 0;
+    while ( m_executor->queueSize() > 0 ) {
+        m_executor->processNext();
+        cnt++;
+    }
+    return cnt;
+}
+
+void Test::advanceTime(safl::Executor::Clock::duration duration) noexcept
+{
+    m_executor->advanceTime(duration);
+}
+
 std::size_t Test::queueSize() noexcept
 {
     return m_executor->queueSize();